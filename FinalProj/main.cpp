@@ -7,72 +7,267 @@
 */
 
 #include <iostream>
+#include <ctime>
 
 #include "src/config.h"
 #include "src/util.h"
 #include "src/bvh.h"
+#include "src/accel.h"
+#include "src/instance.h"
 #include "src/scene.h"
 #include "src/material.h"
 #include "src/camera.h"
+#include "src/environment.h"
 #include "src/helper.h"
+#include "src/benchmark.h"
+#include "src/render.h"
+#include "src/progressive.h"
+#include "src/checkpoint.h"
+#include "src/batch.h"
+#include "src/renderer.h"
+#include "src/outofcore.h"
+#include "src/scene_cache.h"
+#include "src/temporal.h"
+#include "src/options.h"
 
 // #define DEBUG 1
 
 int main(int argc, char* argv[]) {
-    int image_width = IMAGE_WIDTH;
-    int image_height = static_cast<int>(IMAGE_WIDTH / ASPECT_RADIO);
+    RenderOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+
+    int image_width = options.width;
+    int image_height = options.height;
 
     #ifdef DEBUG
         image_width = DEBUG_IMAGE_WIDTH;
         image_height = DEBUG_IMAGE_HEIGHT;
     #endif
 
-    if(argc < 4) {
-        std::cout << "Parameters required, use default instead!!\n [Usage: ./ray_tracer + num_of_sphere + output_file_name + max_bounce_depth]" << std::endl;
+    // The checkpoint decides the scene and sampling settings
+    CheckpointHeader resume_header;
+    Framebuffer resume_framebuffer;
+    if (options.resume_file) {
+        if (!read_checkpoint(options.resume_file, resume_header, resume_framebuffer)) {
+            std::cerr << "Can't read checkpoint " << options.resume_file << std::endl;
+            return 1;
+        }
+        if (resume_header.config_hash != render_config_hash(options)) {
+            std::cerr << "Checkpoint was rendered with another background, floor texture or scene cache" << std::endl;
+            return 1;
+        }
+        options.num_of_sphere = resume_header.num_of_sphere;
+        options.max_depth = resume_header.max_depth;
+        options.seed = resume_header.seed;
+        options.instanced = resume_header.instanced != 0;
+        image_width = resume_header.width;
+        image_height = resume_header.height;
+        std::cout << "Resuming " << options.resume_file << " after " << resume_header.passes << " passes" << std::endl;
     }
 
-    int num_of_sphere = argv[1] ? atoi(argv[1]) : DEFAULT_SPHERE_NUM; 
-
+    int num_of_sphere = options.num_of_sphere;
     FILE * output_file;
-    char* file_name = DEFAULT_NAME;
-    if(argc >= 3 && argv[2]) {
-        file_name = argv[2];
-    }
-
-    int max_depth = RAY_BOUNCE_DEPTH_LIMIT;
-    if(argc >= 4 && argv[3]) {
-        max_depth = atoi(argv[3]);
-    }
+    const char* file_name = options.file_name;
+    int max_depth = options.max_depth;
 
     std::cout << "Image size is:" << image_width << "*" << image_height << std::endl;
     std::cout << "Number of Sphere: " << num_of_sphere
     << " Output file name: " << file_name << " Max Depth: " << max_depth << std::endl;
-    
-    output_file = fopen(file_name, "w");
-    fprintf(output_file, "P3\n%d %d\n255\n", image_width, image_height);
- 
-    Scene my_scene = generate_random_scene(num_of_sphere);
+
+    if (options.bench_layouts) {
+        // Sphere counts from a tenth of num_of_sphere up to 100x
+        std::vector<int> sphere_counts;
+        for (int count = std::max(num_of_sphere / 10, 1); count <= 100 * num_of_sphere; count *= 10)
+            sphere_counts.push_back(count);
+        run_layout_benchmark(sphere_counts, options.seed, image_width / 4, image_height / 4);
+        return 0;
+    }
 
     // Camera configuration
     Vec3 eye_pt(12, 1.8, 9.8), view_dir(0, 0, 0), up(0, 1, 0);
     double fov = 20, focal_len = 10.0, aperture = 0.1;
 
-    Camera my_view(eye_pt, view_dir, up, fov, ASPECT_RADIO, aperture, focal_len);
+    Camera my_view(eye_pt, view_dir, up, fov, static_cast<double>(image_width) / image_height, aperture, focal_len);
 
-    for (int j = image_height - 1; j >= 0; --j) {
-        for (int i = 0; i < image_width; ++i) {
-            Vec3 pixel_color;
-            for (int k = 0; k < NUM_OF_SAMPLES_PER_PIXEL; ++k) {
-                auto u = (i + generate_random_double()) / (image_width - 1);
-                auto v = (j + generate_random_double()) / (image_height - 1);
+    shared_ptr<Texture> floor_texture;
+    if (options.floor_texture) {
+        auto floor_image = load_image(options.floor_texture);
+        if (!floor_image) {
+            std::cerr << "Can't read floor texture " << options.floor_texture << std::endl;
+            return 1;
+        }
+        floor_texture = make_shared<ImageTexture>(floor_image);
+    }
 
-                Ray r = my_view.emit_ray(u, v);
-                pixel_color += generate_pixel_color(r, my_scene, max_depth);
+    shared_ptr<Object> my_scene;
+    if (options.instanced) {
+        auto instanced_scene = generate_instanced_scene(num_of_sphere, options.seed, floor_texture);
+        std::cout << "Instanced scene: " << instanced_scene->num_instances() << " instances of "
+                  << instanced_scene->num_geometries() << " geometries" << std::endl;
+        my_scene = instanced_scene;
+    } else if (options.scene_cache) {
+        // Traced in place: no scene generation or BVH build
+        auto start = std::chrono::steady_clock::now();
+        auto mapped_scene = MappedScene::open(options.scene_cache);
+        if (!mapped_scene) {
+            return 1;
+        }
+        const SceneCacheHeader& cache_header = mapped_scene->get_header();
+        num_of_sphere = cache_header.num_of_sphere;
+        std::cout << "Scene cache: " << cache_header.num_spheres << " spheres, " << cache_header.num_planes
+                  << " planes mapped in " << 1000 * elapsed_seconds(start) << " ms" << std::endl;
+        my_scene = mapped_scene;
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        Scene flat_scene = generate_random_scene(num_of_sphere, options.seed, floor_texture);
+        if (options.bench) {
+            run_accel_benchmark(flat_scene.objects, my_view, image_width, image_height);
+            return 0;
+        }
+        if (options.write_scene_cache) {
+            if (!write_scene_cache(options.write_scene_cache, flat_scene.objects, num_of_sphere, options.seed)) {
+                return 1;
             }
-            write_pixel_file_line(output_file, pixel_color, NUM_OF_SAMPLES_PER_PIXEL);
+            std::cout << "Scene cache written to " << options.write_scene_cache << std::endl;
+        }
+        my_scene = build_accel(flat_scene.objects, options.accel);
+        std::cout << "Scene generated and built in " << 1000 * elapsed_seconds(start) << " ms" << std::endl;
+        std::cout << "Acceleration structure: " << ACCEL_NAMES[options.accel] << std::endl;
+    }
+
+    shared_ptr<Background> background = make_shared<SkyGradient>();
+    if (options.envmap_dir) {
+        background = load_environment_map(options.envmap_dir, options.env_intensity);
+        if (!background) {
+            return 1;
+        }
+    }
+
+    shared_ptr<RadianceCache> radiance_cache;
+    if (options.radiance_cache) {
+        radiance_cache = make_shared<RadianceCache>(static_cast<size_t>(options.cache_memory) << 20,
+                                                    options.cache_cell_size, options.cache_spread);
+        // Cell sizes grow from the distance of the main view's subject, around whichever camera traces
+        radiance_cache->set_level_of_detail((view_dir - eye_pt).length());
+        std::cout << "Radiance cache: " << radiance_cache->capacity() << " cells, cell size " << options.cache_cell_size
+                  << ", spread " << options.cache_spread << std::endl;
+    }
+
+    if (options.views_file) {
+        // All views share the scene and acceleration structure built above
+        std::vector<ViewDefinition> views;
+        if (!load_view_list(options.views_file, views)) {
+            std::cerr << "Can't read view list " << options.views_file << std::endl;
+            return 1;
         }
-        std::cout << "\rWriting line finishes: " << j << std::flush;
+        RenderContext ctx = {my_scene.get(), nullptr, background.get(), image_width, image_height, max_depth, options.seed, radiance_cache.get()};
+        BatchRenderer(ctx, options.samples_per_pixel, options.num_threads).render(views);
+        return 0;
     }
 
+    if (options.animate_frames > 0) {
+        // Orbit around the look-at point; pinhole camera, reprojection doesn't model defocus
+        RenderContext ctx = {my_scene.get(), nullptr, background.get(), image_width, image_height, max_depth, options.seed, radiance_cache.get()};
+        TemporalSettings settings;
+        settings.samples_per_pixel = options.samples_per_pixel;
+        settings.max_history = options.samples_per_pixel;
+        settings.reuse = options.temporal_reuse;
+        settings.num_threads = options.num_threads;
+        TemporalRenderer renderer(ctx, settings);
+
+        double total_seconds = 0;
+        for (int frame = 0; frame < options.animate_frames; ++frame) {
+            double angle = deg_to_rad(options.orbit_degrees) * frame / std::max(options.animate_frames - 1, 1);
+            Vec3 arm = eye_pt - view_dir;
+            Vec3 eye = view_dir + Vec3(arm.x() * cos(angle) - arm.z() * sin(angle), arm.y(), arm.x() * sin(angle) + arm.z() * cos(angle));
+            Camera frame_view(eye, view_dir, up, fov, static_cast<double>(image_width) / image_height, 0, focal_len);
+
+            std::string frame_name = frame_file_name(file_name, frame);
+            FrameStats stats = renderer.render_frame(frame_view, frame_name);
+            total_seconds += stats.seconds;
+            std::cout << frame_name << ": " << stats.seconds << "s, " << static_cast<int>(100 * stats.reused_fraction)
+                      << "% pixels reused, " << static_cast<double>(stats.samples) / (static_cast<double>(image_width) * image_height)
+                      << " spp traced" << std::endl;
+        }
+        std::cout << "Animation: " << options.animate_frames << " frames, " << total_seconds / options.animate_frames
+                  << "s per frame" << std::endl;
+        return 0;
+    }
+
+    if (options.progressive) {
+        RenderContext ctx = {my_scene.get(), &my_view, background.get(), image_width, image_height, max_depth, options.seed, radiance_cache.get()};
+        ProgressiveSettings settings;
+        settings.max_passes = options.samples_per_pixel;
+        settings.time_budget = options.time_budget;
+        settings.noise_target = options.noise_target;
+        settings.write_interval = options.write_interval;
+        settings.write_every_passes = options.write_every;
+        settings.num_threads = options.num_threads;
+        if (options.checkpoint_file) {
+            settings.checkpoint_file = options.checkpoint_file;
+            settings.checkpoint_interval = options.checkpoint_interval;
+        }
+
+        ProgressiveRenderer renderer(ctx, settings);
+        CheckpointHeader header = CheckpointHeader();
+        header.max_depth = max_depth;
+        header.num_of_sphere = num_of_sphere;
+        header.instanced = options.instanced ? 1 : 0;
+        header.seed = options.seed;
+        header.config_hash = render_config_hash(options);
+        renderer.set_checkpoint_header(header);
+
+        if (options.resume_file && !renderer.resume(resume_framebuffer)) {
+            std::cerr << "Checkpoint image size doesn't match" << std::endl;
+            return 1;
+        }
+        renderer.render(file_name);
+        return 0;
+    }
+
+    RenderSettings settings;
+    settings.width = image_width;
+    settings.height = image_height;
+    settings.samples_per_pixel = options.samples_per_pixel;
+    settings.max_depth = max_depth;
+    settings.seed = options.seed;
+    settings.num_threads = options.num_threads;
+    Renderer renderer(my_scene, my_view, settings, background);
+    renderer.set_radiance_cache(radiance_cache);
+
+    if (options.out_of_core) {
+        if (!render_out_of_core(renderer, file_name, static_cast<size_t>(options.memory_budget) << 20)) {
+            return 1;
+        }
+        std::cout << "\nWrite to File Done" << std::endl;
+        return 0;
+    }
+
+    output_file = fopen(file_name, "w");
+    if (!output_file) {
+        std::cerr << "Can't create " << file_name << std::endl;
+        return 1;
+    }
+    fprintf(output_file, "P3\n%d %d\n255\n", image_width, image_height);
+
+    // Render bands of rows into one reused buffer, each written out as soon as it's done
+    int band_rows = std::min(RENDER_BAND_ROWS, image_height);
+    std::vector<float> band(3 * static_cast<size_t>(image_width) * band_rows);
+    for (int y = 0; y < image_height; y += band_rows) {
+        RenderRegion region = {0, y, image_width, std::min(band_rows, image_height - y)};
+        renderer.render(band.data(), 0, region);
+        for (size_t p = 0; p < 3 * static_cast<size_t>(image_width) * region.height; p += 3) {
+            write_pixel_file_line(output_file, Vec3(band[p], band[p + 1], band[p + 2]), 1);
+        }
+        std::cout << "\rWriting line finishes: " << image_height - y - region.height << std::flush;
+    }
+    fclose(output_file);
+
     std::cout << "\nWrite to File Done" << std::endl;
+    if (radiance_cache) {
+        std::cout << "Radiance cache: " << radiance_cache->num_cells() << " of " << radiance_cache->capacity()
+                  << " cells used" << std::endl;
+    }
 }
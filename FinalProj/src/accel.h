@@ -0,0 +1,102 @@
+#ifndef _CS418_ACCEL_H
+#define _CS418_ACCEL_H
+
+#include <cstring>
+#include <vector>
+
+#include "util.h"
+#include "object.h"
+#include "scene.h"
+#include "bvh.h"
+#include "wide_bvh.h"
+#include "grid.h"
+
+// Acceleration structures selectable with --accel
+enum AccelType {
+    ACCEL_NONE,   // linear Scene::intersect loop
+    ACCEL_BVH,    // binary BVH
+    ACCEL_WIDE4,  // 4-wide quantized BVH
+    ACCEL_WIDE8,  // 8-wide quantized BVH
+    ACCEL_GRID,   // dense uniform grid
+    ACCEL_HASHGRID // sparse hashed grid
+};
+
+const char* const ACCEL_NAMES[] = {"none", "bvh", "wide4", "wide8", "grid", "hashgrid"};
+const int NUM_ACCEL_TYPES = 6;
+
+/**
+    Parse an acceleration structure name
+    @param char* name (none / bvh / wide4 / wide8 / grid / hashgrid)
+    @return false when the name is unknown
+*/
+inline bool parse_accel_type(const char* name, AccelType& type) {
+    for (int i = 0; i < NUM_ACCEL_TYPES; ++i) {
+        if (strcmp(name, ACCEL_NAMES[i]) == 0) {
+            type = static_cast<AccelType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Acceleration structure plus the unbounded objects (planes) kept out of it.
+// The unbounded ones are tested first so their hit shortens the traversal.
+class UnboundedAccel : public Object {
+    public:
+        UnboundedAccel(const std::vector<shared_ptr<Object>>& unbounded_objects, shared_ptr<Object> bounded_accel)
+            : unbounded(unbounded_objects), accel(bounded_accel) {}
+
+        bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            bool hit = false;
+            for (const auto& object : unbounded) {
+                if (object->intersect(r, t_min, t_max, int_pt)) {
+                    hit = true;
+                    t_max = int_pt.t;
+                }
+            }
+            return (accel && accel->intersect(r, t_min, t_max, int_pt)) || hit;
+        }
+
+        bool get_bbox(BoundingBox& output_box) const {
+            return false;
+        }
+
+        const Object* bounded_accel() const { return accel.get(); }
+        size_t num_unbounded() const { return unbounded.size(); }
+
+    private:
+        std::vector<shared_ptr<Object>> unbounded;
+        shared_ptr<Object> accel;
+};
+
+/**
+    Build the requested acceleration structure over a list of objects
+    @param vector objects (copied, the BVH builder reorders its input)
+    @param AccelType type
+*/
+inline shared_ptr<Object> build_accel(std::vector<shared_ptr<Object>> objects, AccelType type) {
+    // Objects without a bounding box can't go in a hierarchy
+    std::vector<shared_ptr<Object>> bounded, unbounded;
+    for (const auto& object : objects) {
+        BoundingBox box;
+        (object->get_bbox(box) ? bounded : unbounded).push_back(object);
+    }
+    if (!unbounded.empty() && type != ACCEL_NONE)
+        return make_shared<UnboundedAccel>(unbounded, bounded.empty() ? nullptr : build_accel(bounded, type));
+
+    if (objects.empty() || type == ACCEL_NONE) {
+        auto scene = make_shared<Scene>();
+        scene->objects = objects;
+        return scene;
+    }
+
+    switch (type) {
+        case ACCEL_WIDE4: return make_shared<WideBVH<4>>(objects);
+        case ACCEL_WIDE8: return make_shared<WideBVH<8>>(objects);
+        case ACCEL_GRID:  return make_shared<UniformGrid>(objects);
+        case ACCEL_HASHGRID: return make_shared<HashGrid>(objects);
+        default:          return make_shared<BVH>(objects, 0, objects.size());
+    }
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef _CS418_BATCH_H
+#define _CS418_BATCH_H
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "camera.h"
+#include "framebuffer.h"
+#include "render.h"
+
+// One camera of a batch render and the file it is written to
+struct ViewDefinition {
+    std::string output;
+    Vec3 eye_pt;
+    Vec3 view_dir; // look-at point, like main's camera configuration
+    Vec3 up = Vec3(0, 1, 0);
+    double fov = 20;
+    double aperture = 0.1;
+    double focal_len = 10.0;
+};
+
+/**
+    Read a view list: one view per line, '#' starts a comment
+    "output eye_x eye_y eye_z look_x look_y look_z [fov [aperture [focal_len]]]"
+    @param char* path
+    @return false when the file can't be read or a line is malformed
+*/
+inline bool load_view_list(const char* path, std::vector<ViewDefinition>& views) {
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    char line[1024];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        ++line_number;
+        char name[512];
+        double v[9];
+        int fields = sscanf(line, "%511s %lf %lf %lf %lf %lf %lf %lf %lf %lf",
+                            name, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8]);
+        if (fields <= 0 || name[0] == '#')
+            continue;
+        if (fields < 7) {
+            std::cerr << path << ":" << line_number << ": expected output file, eye point and look-at point" << std::endl;
+            ok = false;
+            break;
+        }
+
+        ViewDefinition view;
+        view.output = name;
+        view.eye_pt = Vec3(v[0], v[1], v[2]);
+        view.view_dir = Vec3(v[3], v[4], v[5]);
+        if (fields > 7) view.fov = v[6];
+        if (fields > 8) view.aperture = v[7];
+        if (fields > 9) view.focal_len = v[8];
+        views.push_back(view);
+    }
+    fclose(file);
+    return ok && !views.empty();
+}
+
+// Renders many views of one scene: tiles of all views go through one shared work
+// queue, so threads move on to the next view while the last tiles of a view finish.
+// A view's image is written by whichever thread completes its last tile.
+class BatchRenderer {
+    public:
+        BatchRenderer(const RenderContext& base_context, int samples, int threads)
+            : base(base_context), samples_per_pixel(samples), num_threads(threads) {}
+
+        void render(const std::vector<ViewDefinition>& views) {
+            auto start = std::chrono::steady_clock::now();
+            int tiles_x = (base.width + BATCH_TILE_SIZE - 1) / BATCH_TILE_SIZE;
+            int tiles_y = (base.height + BATCH_TILE_SIZE - 1) / BATCH_TILE_SIZE;
+            int tiles_per_view = tiles_x * tiles_y;
+
+            std::vector<Camera> cameras;
+            std::unique_ptr<ViewState[]> state(new ViewState[views.size()]);
+            double aspect_ratio = static_cast<double>(base.width) / base.height;
+            for (size_t k = 0; k < views.size(); ++k) {
+                const ViewDefinition& v = views[k];
+                cameras.push_back(Camera(v.eye_pt, v.view_dir, v.up, v.fov, aspect_ratio, v.aperture, v.focal_len));
+                state[k].remaining = tiles_per_view;
+            }
+
+            std::atomic<int> views_done(0);
+            int total_tiles = static_cast<int>(views.size()) * tiles_per_view;
+            parallel_for(total_tiles, num_threads, [&](int tile) {
+                int k = tile / tiles_per_view, t = tile % tiles_per_view;
+                ViewState& view = state[k];
+
+                // Framebuffers only exist while their view is in flight
+                std::call_once(view.allocated, [&]() { view.framebuffer = Framebuffer(base.width, base.height); });
+
+                RenderContext ctx = base;
+                ctx.camera = &cameras[k];
+                ctx.seed = mix_seed(base.seed + k);
+
+                int x0 = (t % tiles_x) * BATCH_TILE_SIZE, y0 = (t / tiles_x) * BATCH_TILE_SIZE;
+                int x1 = std::min(x0 + BATCH_TILE_SIZE, base.width), y1 = std::min(y0 + BATCH_TILE_SIZE, base.height);
+                for (int y = y0; y < y1; ++y)
+                    for (int x = x0; x < x1; ++x)
+                        for (int s = 0; s < samples_per_pixel; ++s)
+                            view.framebuffer.add_sample(x, y, render_sample(ctx, x, y, s));
+
+                if (--view.remaining == 0) {
+                    if (!view.framebuffer.write_ppm(views[k].output))
+                        std::cerr << "\nFailed to write " << views[k].output << std::endl;
+                    view.framebuffer = Framebuffer();
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    std::cout << "\rViews written: " << ++views_done << "/" << views.size() << std::flush;
+                }
+            });
+            std::cout << "\nBatch render: " << views.size() << " views in " << elapsed_seconds(start) << "s" << std::endl;
+        }
+
+    private:
+        struct ViewState {
+            std::once_flag allocated;
+            std::atomic<int> remaining;
+            Framebuffer framebuffer;
+        };
+
+        RenderContext base;
+        int samples_per_pixel;
+        int num_threads;
+        std::mutex output_mutex;
+};
+
+#endif
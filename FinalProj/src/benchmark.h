@@ -0,0 +1,244 @@
+#ifndef _CS418_BENCHMARK_H
+#define _CS418_BENCHMARK_H
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "util.h"
+#include "object.h"
+#include "camera.h"
+#include "accel.h"
+#include "render.h"
+#include "helper.h"
+
+/**
+    Fixed ray set for benchmarks: one camera ray per pixel plus one diffuse
+    bounce (incoherent) from every camera ray that hits something
+    @param Object reference structure used to find the bounce origins
+*/
+inline std::vector<Ray> generate_benchmark_rays(const Object& reference, const Camera& camera, int width, int height) {
+    std::vector<Ray> rays;
+    rays.reserve(2 * width * height);
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+            rays.push_back(camera.emit_ray((i + 0.5) / (width - 1), (j + 0.5) / (height - 1)));
+        }
+    }
+
+    size_t num_primary = rays.size();
+    for (size_t k = 0; k < num_primary; ++k) {
+        Intersection rec;
+        if (reference.intersect(rays[k], 0.001, INF_DOUBLE, rec))
+            rays.push_back(Ray(rec.point, rec.normal + generate_random_unit_vec()));
+    }
+    return rays;
+}
+
+/**
+    Trace rays (closest hit) for at most time_limit seconds
+    @return rays per second; hits and sum_t are filled for the rays traced
+*/
+inline double trace_benchmark_rays(const Object& accel, const std::vector<Ray>& rays, double time_limit,
+                            size_t& traced, size_t& hits, double& sum_t) {
+    auto start = std::chrono::steady_clock::now();
+    traced = hits = 0;
+    sum_t = 0;
+    for (const auto& ray : rays) {
+        Intersection rec;
+        if (accel.intersect(ray, 0.001, INF_DOUBLE, rec)) {
+            ++hits;
+            sum_t += rec.t;
+        }
+        // Check the clock every 4096 rays only
+        if ((++traced & 4095) == 0 && elapsed_seconds(start) > time_limit)
+            break;
+    }
+    return traced / elapsed_seconds(start);
+}
+
+// Size of the last AllocationProbe allocation
+inline size_t& last_allocation_bytes() {
+    static size_t bytes = 0;
+    return bytes;
+}
+
+// Stateless allocator recording the size of its last allocation: allocate_shared<T> with
+// it lays out the same block (object + control block) as make_shared<T>
+template <typename T>
+struct AllocationProbe {
+    typedef T value_type;
+
+    AllocationProbe() {}
+    template <typename U> AllocationProbe(const AllocationProbe<U>&) {}
+
+    T* allocate(size_t n) {
+        last_allocation_bytes() = n * sizeof(T);
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t) { ::operator delete(p); }
+};
+
+template <typename T, typename U>
+inline bool operator==(const AllocationProbe<T>&, const AllocationProbe<U>&) { return true; }
+template <typename T, typename U>
+inline bool operator!=(const AllocationProbe<T>&, const AllocationProbe<U>&) { return false; }
+
+// Bytes make_shared<T>() allocates in one block on this standard library
+template <typename T>
+inline size_t shared_block_bytes() {
+    std::allocate_shared<T>(AllocationProbe<T>());
+    return last_allocation_bytes();
+}
+
+/**
+    Node (or cell) count and memory of an acceleration structure built by build_accel:
+    the bytes allocated for its nodes, without the allocator's own bookkeeping
+    @param size_t num_objects it was built over
+*/
+inline void accel_memory(const Object& accel, AccelType type, size_t num_objects, size_t& nodes, size_t& bytes) {
+    nodes = bytes = 0;
+    if (const UnboundedAccel* split = dynamic_cast<const UnboundedAccel*>(&accel)) {
+        if (split->bounded_accel())
+            accel_memory(*split->bounded_accel(), type, num_objects - split->num_unbounded(), nodes, bytes);
+        return;
+    }
+
+    if (type == ACCEL_BVH) {
+        // One make_shared block (node and control block) per internal split
+        nodes = num_objects > 1 ? num_objects - 1 : 1;
+        bytes = nodes * shared_block_bytes<BVH>();
+    } else if (type == ACCEL_WIDE4) {
+        nodes = static_cast<const WideBVH<4>&>(accel).num_nodes();
+        bytes = static_cast<const WideBVH<4>&>(accel).memory_bytes();
+    } else if (type == ACCEL_WIDE8) {
+        nodes = static_cast<const WideBVH<8>&>(accel).num_nodes();
+        bytes = static_cast<const WideBVH<8>&>(accel).memory_bytes();
+    } else if (type == ACCEL_GRID) {
+        nodes = static_cast<const UniformGrid&>(accel).num_cells();
+        bytes = static_cast<const UniformGrid&>(accel).memory_bytes();
+    } else if (type == ACCEL_HASHGRID) {
+        nodes = static_cast<const HashGrid&>(accel).num_cells();
+        bytes = static_cast<const HashGrid&>(accel).memory_bytes();
+    }
+}
+
+/**
+    Build every acceleration structure over the same objects and report build time,
+    nodes (grid cells), memory and traversal rays/sec on the same ray set
+    @param vector objects of the scene
+    @param Camera view used for the camera rays
+    @param double time_limit seconds of tracing per structure
+    @param size_t max_linear: the linear list is skipped above this many objects (0: never)
+*/
+inline void run_accel_benchmark(const std::vector<shared_ptr<Object>>& objects, const Camera& camera, int width, int height,
+                                double time_limit = BENCHMARK_TIME_LIMIT, size_t max_linear = 0) {
+    auto reference = build_accel(objects, ACCEL_BVH);
+    std::vector<Ray> rays = generate_benchmark_rays(*reference, camera, width, height);
+    std::cout << "Benchmark: " << objects.size() << " objects, " << rays.size() << " rays" << std::endl;
+    std::cout << std::left << std::setw(10) << "accel" << std::setw(12) << "build(ms)" << std::setw(10) << "nodes"
+              << std::setw(12) << "memory(KB)" << std::setw(12) << "Mrays/s" << "hits/traced" << std::endl;
+
+    for (int type = 0; type < NUM_ACCEL_TYPES; ++type) {
+        if (type == ACCEL_NONE && max_linear > 0 && objects.size() > max_linear)
+            continue;
+
+        auto start = std::chrono::steady_clock::now();
+        auto accel = build_accel(objects, static_cast<AccelType>(type));
+        double build_ms = 1000 * elapsed_seconds(start);
+
+        size_t nodes, bytes;
+        accel_memory(*accel, static_cast<AccelType>(type), objects.size(), nodes, bytes);
+
+        size_t traced, hits;
+        double sum_t;
+        double rays_per_sec = trace_benchmark_rays(*accel, rays, time_limit, traced, hits, sum_t);
+        std::cout << std::left << std::setw(10) << ACCEL_NAMES[type] << std::setw(12) << std::fixed << std::setprecision(1) << build_ms
+                  << std::setw(10) << nodes << std::setw(12) << bytes / 1024 << std::setw(12) << std::setprecision(3) << rays_per_sec / 1e6
+                  << hits << "/" << traced << std::endl;
+    }
+}
+
+// Sphere distributions of --bench-layouts
+enum BenchmarkLayout {
+    LAYOUT_SCENE,     // the default scene: jittered spheres on the floor plane
+    LAYOUT_SPHERE_FLOOR, // same with the floor as a sphere of radius 1000 inside the structure
+    LAYOUT_JITTERED,  // same spheres without the floor
+    LAYOUT_UNIFORM,   // uniform random in a cube
+    LAYOUT_CLUSTERED  // a few dense gaussian clusters in a large empty volume
+};
+
+const char* const LAYOUT_NAMES[] = {"scene", "sphere-floor", "jittered", "uniform", "clustered"};
+const int NUM_LAYOUTS = 5;
+
+/**
+    Spheres of a benchmark layout (one shared material except for the default scene)
+    @param BenchmarkLayout layout
+    @param int num_of_sphere
+    @param BoundingBox frame: bounds of the spheres without the floor, to aim the camera
+*/
+inline std::vector<shared_ptr<Object>> generate_benchmark_layout(BenchmarkLayout layout, int num_of_sphere, uint64_t seed, BoundingBox& frame) {
+    std::vector<shared_ptr<Object>> objects;
+    if (layout == LAYOUT_SCENE || layout == LAYOUT_SPHERE_FLOOR || layout == LAYOUT_JITTERED) {
+        objects = generate_random_scene(num_of_sphere, seed).objects;
+        objects.erase(objects.begin()); // floor
+    } else {
+        seed_random(seed);
+        auto material = make_shared<DiffuseMaterial>(make_shared<Solid>(0.5, 0.5, 0.5));
+        double side = cbrt(static_cast<double>(num_of_sphere)); // about one sphere per unit cube
+        std::vector<Vec3> centers;
+        for (int k = 0; k < 8; ++k)
+            centers.push_back(Vec3::random(0, 4 * side));
+
+        for (int i = 0; i < num_of_sphere; ++i) {
+            Vec3 pos;
+            if (layout == LAYOUT_UNIFORM) {
+                pos = Vec3::random(0, side);
+            } else {
+                // Box-Muller around a random cluster center
+                const Vec3& c = centers[generate_random_int(0, static_cast<int>(centers.size()))];
+                for (int a = 0; a < 3; ++a) {
+                    double u1 = fmax(generate_random_double(), 1e-12), u2 = generate_random_double();
+                    pos[a] = c[a] + 0.15 * side * sqrt(-2 * log(u1)) * cos(2 * PI * u2);
+                }
+            }
+            objects.push_back(make_shared<Sphere>(pos, generate_random_double(0.16, 0.26), material));
+        }
+    }
+
+    for (size_t i = 0; i < objects.size(); ++i) {
+        BoundingBox box;
+        objects[i]->get_bbox(box);
+        frame = i == 0 ? box : surrounding_box(frame, box);
+    }
+    if (layout == LAYOUT_SCENE || layout == LAYOUT_SPHERE_FLOOR)
+        objects = generate_random_scene(num_of_sphere, seed).objects;
+    if (layout == LAYOUT_SPHERE_FLOOR)
+        objects[0] = make_shared<Sphere>(Vec3(0, -1000, 0), 1000, make_shared<DiffuseMaterial>(make_shared<Solid>(1, 1, 1)));
+    return objects;
+}
+
+/**
+    run_accel_benchmark over several sphere counts and every layout,
+    with a camera looking at the spheres from above one corner
+    @param vector<int> sphere_counts
+*/
+inline void run_layout_benchmark(const std::vector<int>& sphere_counts, uint64_t seed, int width, int height) {
+    for (int count : sphere_counts) {
+        for (int layout = 0; layout < NUM_LAYOUTS; ++layout) {
+            BoundingBox frame;
+            auto objects = generate_benchmark_layout(static_cast<BenchmarkLayout>(layout), count, seed, frame);
+            Vec3 center = 0.5 * (frame.min() + frame.max());
+            Vec3 eye = center + 0.6 * (frame.max() - frame.min()).length() * Vec3(1, 0.8, 1);
+            Camera camera(eye, center, Vec3(0, 1, 0), 40, static_cast<double>(width) / height, 0, 1);
+
+            std::cout << "\nLayout " << LAYOUT_NAMES[layout] << ", " << count << " spheres" << std::endl;
+            run_accel_benchmark(objects, camera, width, height, LAYOUT_BENCHMARK_TIME_LIMIT, 2000);
+        }
+    }
+}
+
+#endif
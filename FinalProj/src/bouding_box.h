@@ -49,7 +49,7 @@ class BoundingBox {
         Vec3 _max;
 };
 
-BoundingBox surrounding_box(BoundingBox box0, BoundingBox box1) {
+inline BoundingBox surrounding_box(BoundingBox box0, BoundingBox box1) {
     Vec3 small(fmin(box0.min().x(), box1.min().x()),
                fmin(box0.min().y(), box1.min().y()),
                fmin(box0.min().z(), box1.min().z()));
@@ -39,7 +39,7 @@ class BVH : public Object  {
 };
 
 // Generic Comparator for x/y/z axis
-bool box_compare(const shared_ptr<Object> a, const shared_ptr<Object> b, int axis) {
+inline bool box_compare(const shared_ptr<Object> a, const shared_ptr<Object> b, int axis) {
     BoundingBox box_a;
     BoundingBox box_b;
 
@@ -49,20 +49,20 @@ bool box_compare(const shared_ptr<Object> a, const shared_ptr<Object> b, int axi
     return box_a.min().e[axis] < box_b.min().e[axis];
 }
 
-bool box_x_compare (const shared_ptr<Object> a, const shared_ptr<Object> b) {
+inline bool box_x_compare (const shared_ptr<Object> a, const shared_ptr<Object> b) {
     return box_compare(a, b, 0);
 }
 
-bool box_y_compare (const shared_ptr<Object> a, const shared_ptr<Object> b) {
+inline bool box_y_compare (const shared_ptr<Object> a, const shared_ptr<Object> b) {
     return box_compare(a, b, 1);
 }
 
-bool box_z_compare (const shared_ptr<Object> a, const shared_ptr<Object> b) {
+inline bool box_z_compare (const shared_ptr<Object> a, const shared_ptr<Object> b) {
     return box_compare(a, b, 2);
 }
 
 // Build BVH from vector of objects
-BVH::BVH(std::vector<shared_ptr<Object>>& objects, int start, int end) {
+inline BVH::BVH(std::vector<shared_ptr<Object>>& objects, int start, int end) {
     int axis = generate_random_int(0,3);
     auto my_comparator = box_x_compare;
     if(axis == 1) {
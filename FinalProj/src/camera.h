@@ -22,16 +22,45 @@ class Camera {
 
             lower_left_corner = origin - half_width*focal_len*u - half_height*focal_len*v - focal_len*w;
 
+            view_height = 2 * half_height;
             horizontal = 2 * half_width * focal_len * u;
             vertical = 2 * half_height * focal_len * v;
         }
 
-        Ray emit_ray(double s, double t) const {
+        /**
+            Ray through (s, t) from a random point of the lens
+            @param double spread cone angle of the ray (see pixel_spread), 0: none
+        */
+        Ray emit_ray(double s, double t, double spread = 0) const {
             Vec3 rd = lens_radius * generate_random_vec_circle();
             Vec3 offset = u * rd.x() + v * rd.y();
-            return Ray(origin + offset, lower_left_corner + s * horizontal + t * vertical - origin - offset);
+            return Ray(origin + offset, lower_left_corner + s * horizontal + t * vertical - origin - offset, spread);
         }
 
+        // Angle covered by one pixel of an image image_height pixels high
+        double pixel_spread(int image_height) const {
+            return view_height / image_height;
+        }
+
+        // Ray through (s, t) from the lens center (no defocus)
+        Ray center_ray(double s, double t) const {
+            return Ray(origin, lower_left_corner + s * horizontal + t * vertical - origin);
+        }
+
+        // Inverse of center_ray: image coordinates (s, t) of a world point, false if behind the camera
+        bool project(const Vec3& point, double& s, double& t) const {
+            Vec3 d = point - origin;
+            double depth = -dot(d, w);
+            if (depth <= 0)
+                return false;
+            Vec3 on_plane = origin + d * (dot(lower_left_corner - origin, -w) / depth) - lower_left_corner;
+            s = dot(on_plane, horizontal) / horizontal.square_len();
+            t = dot(on_plane, vertical) / vertical.square_len();
+            return true;
+        }
+
+        const Vec3& get_origin() const { return origin; }
+
     private:
         Vec3 origin;
         Vec3 lower_left_corner;
@@ -39,6 +68,7 @@ class Camera {
         Vec3 vertical;
         Vec3 u, v, w;
         double lens_radius;
+        double view_height; // height of the view at unit distance
 };
 
 #endif
@@ -0,0 +1,118 @@
+#ifndef _CS418_CHECKPOINT_H
+#define _CS418_CHECKPOINT_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "util.h"
+#include "framebuffer.h"
+
+// Fixed-size header of a checkpoint file (native byte order), followed by the
+// framebuffer arrays: sum (3 floats/pixel), sum_sq (1 float/pixel), count (1 uint32/pixel)
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t max_depth;
+    int32_t num_of_sphere;
+    uint32_t instanced;
+    uint64_t seed;
+    uint64_t config_hash;   // other settings that change the image (background)
+    uint32_t passes;        // complete passes (per-pixel counts are the next sample indices)
+    uint32_t reserved;
+};
+
+const char CHECKPOINT_MAGIC[8] = {'C', 'S', '4', '1', '8', 'C', 'K', 'P'};
+const uint32_t CHECKPOINT_VERSION = 2; // 2: floor is a plane (older checkpoints render another scene)
+
+/**
+    Write a checkpoint through a temp file so a crash never leaves a torn checkpoint
+    @param string path
+    @return false on I/O error
+*/
+inline bool write_checkpoint(const std::string& path, const CheckpointHeader& header, const Framebuffer& framebuffer) {
+    std::string temp_name = path + ".tmp";
+    FILE* file = fopen(temp_name.c_str(), "wb");
+    if (!file)
+        return false;
+
+    size_t pixels = static_cast<size_t>(framebuffer.width) * framebuffer.height;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(framebuffer.sum.data(), sizeof(float), 3 * pixels, file) == 3 * pixels &&
+              fwrite(framebuffer.sum_sq.data(), sizeof(float), pixels, file) == pixels &&
+              fwrite(framebuffer.count.data(), sizeof(uint32_t), pixels, file) == pixels;
+    ok = fclose(file) == 0 && ok;
+    return ok && rename(temp_name.c_str(), path.c_str()) == 0;
+}
+
+/**
+    Read a checkpoint written by write_checkpoint
+    @param string path
+    @return false when the file is missing, truncated or of another version
+*/
+inline bool read_checkpoint(const std::string& path, CheckpointHeader& header, Framebuffer& framebuffer) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0 &&
+              header.version == CHECKPOINT_VERSION && header.width > 0 && header.height > 0;
+    if (ok) {
+        framebuffer = Framebuffer(header.width, header.height);
+        size_t pixels = static_cast<size_t>(header.width) * header.height;
+        ok = fread(framebuffer.sum.data(), sizeof(float), 3 * pixels, file) == 3 * pixels &&
+             fread(framebuffer.sum_sq.data(), sizeof(float), pixels, file) == pixels &&
+             fread(framebuffer.count.data(), sizeof(uint32_t), pixels, file) == pixels;
+    }
+    fclose(file);
+    return ok;
+}
+
+// Writes checkpoints on a background thread: the caller hands over a snapshot
+// of the framebuffer and goes on rendering while the file is written
+class CheckpointWriter {
+    public:
+        CheckpointWriter() {}
+        CheckpointWriter(const std::string& file_path) : path(file_path) {}
+        ~CheckpointWriter() { wait(); }
+
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+        bool enabled() const { return !path.empty(); }
+
+        // Skipped (returns false) while the previous checkpoint is still being written
+        bool submit(const CheckpointHeader& header, const Framebuffer& framebuffer) {
+            if (busy)
+                return false;
+            wait();
+            snapshot_header = header;
+            snapshot = framebuffer;
+            busy = true;
+            worker = std::thread([this]() {
+                if (!write_checkpoint(path, snapshot_header, snapshot))
+                    std::cerr << "\nFailed to write checkpoint " << path << std::endl;
+                busy = false;
+            });
+            return true;
+        }
+
+        void wait() {
+            if (worker.joinable())
+                worker.join();
+        }
+
+    private:
+        std::string path;
+        CheckpointHeader snapshot_header;
+        Framebuffer snapshot;
+        std::thread worker;
+        std::atomic<bool> busy{false};
+};
+
+#endif
@@ -1,5 +1,8 @@
+#ifndef _CS418_CONFIG_H
 #define _CS418_CONFIG_H
 
+#include <limits>
+
 // const int IMAGE_WIDTH = 800;
 // const float ASPECT_RADIO = 4/3.f;
 const int IMAGE_WIDTH = 800;
@@ -12,9 +15,78 @@ const int NUM_OF_SAMPLES_PER_PIXEL = 50;
 const int RAY_BOUNCE_DEPTH_LIMIT = 60;
 
 
-char DEFAULT_NAME[11] = "output.ppm";
+const char* const DEFAULT_NAME = "output.ppm";
 const int DEFAULT_SPHERE_NUM = 20;
 
+// Max cube face resolution of the environment importance-sampling table
+const int ENV_IMPORTANCE_RES = 64;
+
+// Materials shared between sphere instances (per material type)
+const int INSTANCE_PALETTE_SIZE = 16;
+
+// Seconds between preview images in --progressive mode
+const double PREVIEW_WRITE_INTERVAL = 2.0;
+// The first pass traces one pixel per block first for a quick coarse image
+const int PREVIEW_BLOCK_SIZE = 4;
+
+// Seconds between checkpoints of a progressive render
+const double CHECKPOINT_INTERVAL = 60.0;
+
+// Tile edge (pixels) of the shared work queue in --views batch mode
+const int BATCH_TILE_SIZE = 32;
+
+// Tile edge (pixels) of the Renderer work queue, and rows per band of the default
+// ppm output (each band is written out as soon as it is rendered)
+const int RENDER_TILE_SIZE = 8;
+const int RENDER_BAND_ROWS = 32;
+
+// Working memory (MB) of --out-of-core rendering
+const int OUT_OF_CORE_MEMORY_BUDGET = 256;
+
+// Scene cache BVH: max spheres per leaf, traversal stack entries
+const int SCENE_CACHE_LEAF_SIZE = 4;
+const int SCENE_CACHE_STACK_SIZE = 64;
+
+// --animate: camera orbit (degrees over the whole animation), new samples per frame
+// in pixels whose history survived, and the history checks
+const double TEMPORAL_ORBIT_DEGREES = 10.0;
+const int TEMPORAL_MIN_SAMPLES = 1;
+const double TEMPORAL_DEPTH_TOLERANCE = 0.03;
+const double TEMPORAL_NORMAL_TOLERANCE = 0.9;
+// Share of the history kept on metal / glass (view-dependent, so reprojection is approximate)
+const double TEMPORAL_SPECULAR_HISTORY = 0.25;
+
+// Radiance cache (--radiance-cache): table size in MB, cell edge in world units (near
+// the subject, cells grow farther away), footprint area of a path (relative to its
+// primary hit's) from which it may end in the cache
+const int RADIANCE_CACHE_MEMORY = 64;
+const double RADIANCE_CACHE_CELL_SIZE = 0.2;
+const double RADIANCE_CACHE_SPREAD = 0.01;
+// Samples a cell needs before it answers lookups, and slots probed per lookup
+const int RADIANCE_CACHE_MIN_SAMPLES = 16;
+const int RADIANCE_CACHE_PROBES = 8;
+// Cells double in size at most this many times with the distance from the camera
+const int RADIANCE_CACHE_MAX_LEVEL = 16;
+// Radiance added to the cache is clamped to this
+const double RADIANCE_CACHE_MAX_RADIANCE = 64.0;
+
+// Max seconds spent tracing per structure in --bench
+const double BENCHMARK_TIME_LIMIT = 3.0;
+// Same, per structure and layout in --bench-layouts
+const double LAYOUT_BENCHMARK_TIME_LIMIT = 1.0;
+
+// Uniform grid: target objects per cell, and caps on its size
+const double GRID_DENSITY = 2.0;
+const double GRID_MAX_CELLS = 1 << 24;
+const int GRID_MAX_RES = 1024;
+// Hash grid: cell edge relative to the median object diagonal
+const double GRID_HASH_CELL_FACTOR = 2.0;
+const int GRID_HASH_MAX_RES = 1 << 20;
+// Objects larger than this times the median size are not put in grid cells
+const double GRID_LARGE_OBJECT_FACTOR = 16.0;
+// Entries of the per-ray mailbox avoiding repeated tests of one object
+const int GRID_MAILBOX_SIZE = 16;
+
 /* For Debug only */
 const int DEBUG_IMAGE_WIDTH = 20;
 const int DEBUG_IMAGE_HEIGHT = 20;
@@ -28,4 +100,6 @@ Todo:
     3. Convert to png --png++ 
     4. Pass parameters to program for scene customization --done! 
     5. Write README --done!
-*/
\ No newline at end of file
+*/
+
+#endif
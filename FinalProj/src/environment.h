@@ -0,0 +1,196 @@
+#ifndef _CS418_ENVIRONMENT_H
+#define _CS418_ENVIRONMENT_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "image.h"
+
+// Radiance arriving from outside the scene (rays that hit nothing)
+// method: 1. radiance: background color seen along a direction
+//         2. sample/pdf: importance sampling of directions (only when can_sample)
+class Background {
+    public:
+        virtual Vec3 radiance(const Vec3& unit_dir) const = 0;
+
+        virtual bool can_sample() const { return false; }
+        virtual Vec3 sample(double u1, double u2, double& pdf) const { pdf = 0; return Vec3(0, 1, 0); }
+        virtual double pdf(const Vec3& unit_dir) const { return 0; }
+};
+
+// Default sky gradient
+class SkyGradient : public Background {
+    public:
+        Vec3 radiance(const Vec3& unit_dir) const {
+            auto t = 0.5 * (unit_dir.y() + 1.0);
+            return (1.0 - t) * Vec3(1.0, 1.0, 1.0) + t * Vec3(0.4, 0.4, 0.6);
+        }
+};
+
+// Piecewise-constant discrete distribution (sampled by inverting its CDF)
+class Distribution1D {
+    public:
+        Distribution1D() {}
+        Distribution1D(const std::vector<double>& weights) {
+            cdf.resize(weights.size() + 1);
+            cdf[0] = 0;
+            for (size_t i = 0; i < weights.size(); ++i)
+                cdf[i + 1] = cdf[i] + weights[i];
+            total = cdf.back();
+            for (auto& c : cdf)
+                c = total > 0 ? c / total : 0;
+        }
+
+        size_t size() const { return cdf.size() - 1; }
+
+        // Returns the picked index; remapped is u rescaled to [0,1) inside that bin
+        size_t sample(double u, double& probability, double& remapped) const {
+            size_t i = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin() - 1;
+            i = std::min(i, size() - 1);
+            probability = cdf[i + 1] - cdf[i];
+            remapped = probability > 0 ? (u - cdf[i]) / probability : 0;
+            return i;
+        }
+
+        double probability(size_t i) const { return cdf[i + 1] - cdf[i]; }
+
+    private:
+        std::vector<double> cdf;
+        double total = 0;
+};
+
+// Cube-map environment (faces +x, -x, +y, -y, +z, -z; OpenGL orientation)
+// with a luminance * solid-angle table over texels for importance sampling
+class EnvironmentMap : public Background {
+    public:
+        EnvironmentMap(const std::vector<shared_ptr<TiledImage>>& cube_faces, double scale = 1.0)
+            : faces(cube_faces), intensity(scale) {
+            // Tables are built from the first mip level that is at most ENV_IMPORTANCE_RES wide
+            table_level = 0;
+            while (faces[0]->width(table_level) > ENV_IMPORTANCE_RES && table_level + 1 < faces[0]->levels())
+                ++table_level;
+            table_res = faces[0]->width(table_level);
+
+            std::vector<double> weights;
+            weights.reserve(6 * table_res * table_res);
+            for (int f = 0; f < 6; ++f) {
+                for (int y = 0; y < table_res; ++y) {
+                    for (int x = 0; x < table_res; ++x) {
+                        Vec3 c = faces[f]->texel(table_level, x, y);
+                        double a = 2 * (x + 0.5) / table_res - 1, b = 2 * (y + 0.5) / table_res - 1;
+                        double solid_angle = 1.0 / pow(1 + a * a + b * b, 1.5);
+                        // Small floor keeps every direction reachable
+                        weights.push_back((luminance(c) + 1e-3) * solid_angle);
+                    }
+                }
+            }
+            table = Distribution1D(weights);
+        }
+
+        Vec3 radiance(const Vec3& unit_dir) const {
+            double s, t;
+            int f = face_coords(unit_dir, s, t);
+            return intensity * faces[f]->bilinear(0, s, t);
+        }
+
+        bool can_sample() const { return true; }
+
+        Vec3 sample(double u1, double u2, double& pdf) const {
+            double p, remapped;
+            size_t index = table.sample(u1, p, remapped);
+            int f = static_cast<int>(index / (table_res * table_res));
+            int y = static_cast<int>(index / table_res % table_res), x = static_cast<int>(index % table_res);
+
+            // Uniform position inside the picked texel
+            double a = 2 * (x + remapped) / table_res - 1, b = 2 * (y + u2) / table_res - 1;
+            pdf = texel_pdf(p, a, b);
+            return unit_vector(face_direction(f, a, b));
+        }
+
+        double pdf(const Vec3& unit_dir) const {
+            double s, t;
+            int f = face_coords(unit_dir, s, t);
+            int x = std::min(static_cast<int>(s * table_res), table_res - 1);
+            int y = std::min(static_cast<int>(t * table_res), table_res - 1);
+            return texel_pdf(table.probability((f * table_res + y) * table_res + x), 2 * s - 1, 2 * t - 1);
+        }
+
+    private:
+        // Solid-angle density of a point (a, b) in [-1,1]^2 on a face, given its texel probability
+        double texel_pdf(double p, double a, double b) const {
+            double texel_area = 4.0 / (table_res * table_res);
+            return p / texel_area * pow(1 + a * a + b * b, 1.5);
+        }
+
+        // Face index and (s, t) in [0,1] (t = 0 at the top row)
+        static int face_coords(const Vec3& d, double& s, double& t) {
+            double ax = fabs(d.x()), ay = fabs(d.y()), az = fabs(d.z());
+            int f;
+            double sc, tc, ma;
+            if (ax >= ay && ax >= az) {
+                f = d.x() > 0 ? 0 : 1; ma = ax;
+                sc = d.x() > 0 ? -d.z() : d.z();
+                tc = -d.y();
+            } else if (ay >= az) {
+                f = d.y() > 0 ? 2 : 3; ma = ay;
+                sc = d.x();
+                tc = d.y() > 0 ? d.z() : -d.z();
+            } else {
+                f = d.z() > 0 ? 4 : 5; ma = az;
+                sc = d.z() > 0 ? d.x() : -d.x();
+                tc = -d.y();
+            }
+            s = clamp(0.5 * (sc / ma + 1), 0.0, 1.0);
+            t = clamp(0.5 * (tc / ma + 1), 0.0, 1.0);
+            return f;
+        }
+
+        // Inverse of face_coords for (a, b) = (2s - 1, 2t - 1), not normalized
+        static Vec3 face_direction(int f, double a, double b) {
+            switch (f) {
+                case 0:  return Vec3(1, -b, -a);
+                case 1:  return Vec3(-1, -b, a);
+                case 2:  return Vec3(a, 1, b);
+                case 3:  return Vec3(a, -1, -b);
+                case 4:  return Vec3(a, -b, 1);
+                default: return Vec3(-a, -b, -1);
+            }
+        }
+
+        std::vector<shared_ptr<TiledImage>> faces;
+        double intensity;
+        Distribution1D table;
+        int table_level;
+        int table_res;
+};
+
+/**
+    Load six cube faces from a directory (posx/negx/... or pos-x/neg-x/... in .pfm or .ppm)
+    @param string directory
+    @return nullptr when a face is missing
+*/
+inline shared_ptr<EnvironmentMap> load_environment_map(const std::string& directory, double intensity = 1.0) {
+    const char* names[6] = {"posx", "negx", "posy", "negy", "posz", "negz"};
+    const char* dashed[6] = {"pos-x", "neg-x", "pos-y", "neg-y", "pos-z", "neg-z"};
+    const char* extensions[2] = {".pfm", ".ppm"};
+
+    std::vector<shared_ptr<TiledImage>> faces;
+    for (int f = 0; f < 6; ++f) {
+        shared_ptr<TiledImage> face;
+        for (int e = 0; !face && e < 2; ++e) {
+            face = load_image(directory + "/" + names[f] + extensions[e]);
+            if (!face)
+                face = load_image(directory + "/" + dashed[f] + extensions[e]);
+        }
+        if (!face || face->width() != face->height() || (f > 0 && face->width() != faces[0]->width())) {
+            std::cerr << "Missing or mismatched cube face " << names[f] << " in " << directory << std::endl;
+            return nullptr;
+        }
+        faces.push_back(face);
+    }
+    return make_shared<EnvironmentMap>(faces, intensity);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef _CS418_FRAMEBUFFER_H
+#define _CS418_FRAMEBUFFER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "helper.h"
+
+// Float accumulation buffer: per-pixel radiance sum, squared luminance sum
+// (for the noise estimate) and sample count. Row 0 is the top of the image.
+class Framebuffer {
+    public:
+        Framebuffer() {}
+        Framebuffer(int w, int h) : width(w), height(h),
+            sum(3 * static_cast<size_t>(w) * h, 0.0f), sum_sq(static_cast<size_t>(w) * h, 0.0f),
+            count(static_cast<size_t>(w) * h, 0) {}
+
+        // Only one thread may add to a given pixel at a time
+        void add_sample(int x, int y, const Vec3& c) {
+            size_t p = static_cast<size_t>(y) * width + x;
+            sum[3 * p]     += static_cast<float>(c.x());
+            sum[3 * p + 1] += static_cast<float>(c.y());
+            sum[3 * p + 2] += static_cast<float>(c.z());
+            float l = static_cast<float>(luminance(c));
+            sum_sq[p] += l * l;
+            ++count[p];
+        }
+
+        Vec3 pixel_sum(int x, int y) const {
+            size_t p = static_cast<size_t>(y) * width + x;
+            return Vec3(sum[3 * p], sum[3 * p + 1], sum[3 * p + 2]);
+        }
+
+        uint32_t samples(int x, int y) const {
+            return count[static_cast<size_t>(y) * width + x];
+        }
+
+        uint64_t total_samples() const {
+            uint64_t total = 0;
+            for (auto c : count)
+                total += c;
+            return total;
+        }
+
+        /**
+            Global noise estimate: mean over pixels of the relative standard error of
+            the pixel luminance (tone-mapped through the gamma 2 we write with)
+            @return 1 when some pixel has fewer than 2 samples
+        */
+        double noise_estimate() const {
+            double total = 0;
+            for (size_t p = 0; p < count.size(); ++p) {
+                if (count[p] < 2)
+                    return 1.0;
+                double n = count[p];
+                double mean = luminance(Vec3(sum[3 * p], sum[3 * p + 1], sum[3 * p + 2])) / n;
+                double variance = fmax(sum_sq[p] / n - mean * mean, 0.0) * n / (n - 1);
+                // d(sqrt(x)) = dx / (2 sqrt(x)): error as seen after gamma correction
+                total += sqrt(variance / n) / (2 * sqrt(mean) + 0.05);
+            }
+            return total / count.size();
+        }
+
+        /**
+            Write the current average as a P3 ppm (through a temp file, so viewers never see half an image)
+            @param string file name
+        */
+        bool write_ppm(const std::string& file_name) const {
+            std::string temp_name = file_name + ".tmp";
+            FILE* output_file = fopen(temp_name.c_str(), "w");
+            if (!output_file)
+                return false;
+            fprintf(output_file, "P3\n%d %d\n255\n", width, height);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    // Pixels without samples yet show their preview block corner
+                    int sx = x, sy = y;
+                    if (samples(x, y) == 0) {
+                        sx -= x % PREVIEW_BLOCK_SIZE;
+                        sy -= y % PREVIEW_BLOCK_SIZE;
+                    }
+                    uint32_t n = samples(sx, sy);
+                    write_pixel_file_line(output_file, pixel_sum(sx, sy), n > 0 ? n : 1);
+                }
+            }
+            fclose(output_file);
+            return rename(temp_name.c_str(), file_name.c_str()) == 0;
+        }
+
+    public:
+        int width = 0;
+        int height = 0;
+        std::vector<float> sum;
+        std::vector<float> sum_sq;
+        std::vector<uint32_t> count;
+};
+
+#endif
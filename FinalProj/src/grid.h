@@ -0,0 +1,307 @@
+#ifndef _CS418_GRID_H
+#define _CS418_GRID_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "util.h"
+#include "object.h"
+
+// Cell layout shared by the dense and the hashed grid, and the 3D-DDA walk
+// (Amanatides & Woo) through it. Objects much larger than the typical one
+// (e.g. a huge floor sphere) are kept out of the cells and tested for every ray.
+class GridBase : public Object {
+    public:
+        bool get_bbox(BoundingBox& output_box) const {
+            output_box = full_box;
+            return has_box;
+        }
+
+        int resolution(int axis) const { return res[axis]; }
+
+    protected:
+        GridBase(const std::vector<shared_ptr<Object>>& objects) : primitives(objects) {
+            std::vector<double> diagonals;
+            boxes.resize(primitives.size());
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                if (!primitives[i]->get_bbox(boxes[i]))
+                    std::cerr << "No bounding box in grid constructor.\n";
+                diagonals.push_back((boxes[i].max() - boxes[i].min()).length());
+                full_box = i == 0 ? boxes[i] : surrounding_box(full_box, boxes[i]);
+            }
+            has_box = !primitives.empty();
+            if (!has_box)
+                return;
+
+            std::vector<double> sorted = diagonals;
+            std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+            median_diagonal = sorted[sorted.size() / 2];
+
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                if (diagonals[i] > GRID_LARGE_OBJECT_FACTOR * median_diagonal) {
+                    large.push_back(static_cast<uint32_t>(i));
+                } else {
+                    small.push_back(static_cast<uint32_t>(i));
+                    grid_box = small.size() == 1 ? boxes[i] : surrounding_box(grid_box, boxes[i]);
+                }
+            }
+        }
+
+        // Set the cell size and resolution from a target cell edge length
+        void set_cell_size(double edge, int max_res) {
+            for (int a = 0; a < 3; ++a) {
+                double extent = grid_box.max()[a] - grid_box.min()[a];
+                res[a] = std::max(1, std::min(max_res, static_cast<int>(ceil(extent / edge))));
+                cell_size[a] = extent > 0 ? extent / res[a] : 1.0;
+                inv_cell_size[a] = 1.0 / cell_size[a];
+            }
+        }
+
+        // Call fn(x, y, z) for every cell overlapped by the box of small object i
+        template <typename Fn>
+        void for_each_cell(uint32_t i, Fn fn) const {
+            int lo[3], hi[3];
+            for (int a = 0; a < 3; ++a) {
+                lo[a] = cell_coord(boxes[i].min()[a], a);
+                hi[a] = cell_coord(boxes[i].max()[a], a);
+            }
+            for (int z = lo[2]; z <= hi[2]; ++z)
+                for (int y = lo[1]; y <= hi[1]; ++y)
+                    for (int x = lo[0]; x <= hi[0]; ++x)
+                        fn(x, y, z);
+        }
+
+        int cell_coord(double p, int a) const {
+            int c = static_cast<int>((p - grid_box.min()[a]) * inv_cell_size[a]);
+            return std::max(0, std::min(res[a] - 1, c));
+        }
+
+        /**
+            Closest hit: large objects first (they shrink t_max), then a DDA walk where
+            cell_items(x, y, z, begin, end) gives the object indices of a cell.
+            A hit only ends the walk once it lies inside the current cell.
+        */
+        template <typename CellItems>
+        bool traverse(const Ray& r, double t_min, double t_max, Intersection& int_pt, CellItems cell_items) const {
+            bool hit = false;
+            for (uint32_t i : large) {
+                if (primitives[i]->intersect(r, t_min, t_max, int_pt)) {
+                    hit = true;
+                    t_max = int_pt.t;
+                }
+            }
+            if (small.empty())
+                return hit;
+
+            // Clip the ray against the grid bounds
+            double t0 = t_min, t1 = t_max;
+            Vec3 o = r.origin(), d = r.direction();
+            for (int a = 0; a < 3; ++a) {
+                double inv = 1.0 / d[a];
+                double ta = (grid_box.min()[a] - o[a]) * inv, tb = (grid_box.max()[a] - o[a]) * inv;
+                if (ta > tb) std::swap(ta, tb);
+                t0 = fmax(t0, ta);
+                t1 = fmin(t1, tb);
+                if (t1 < t0)
+                    return hit;
+            }
+
+            int cell[3], step[3], out[3];
+            double t_next[3], t_delta[3];
+            Vec3 p = r.at(t0);
+            for (int a = 0; a < 3; ++a) {
+                cell[a] = cell_coord(p[a], a);
+                if (d[a] > 0) {
+                    step[a] = 1; out[a] = res[a];
+                    t_next[a] = (grid_box.min()[a] + (cell[a] + 1) * cell_size[a] - o[a]) / d[a];
+                    t_delta[a] = cell_size[a] / d[a];
+                } else if (d[a] < 0) {
+                    step[a] = -1; out[a] = -1;
+                    t_next[a] = (grid_box.min()[a] + cell[a] * cell_size[a] - o[a]) / d[a];
+                    t_delta[a] = -cell_size[a] / d[a];
+                } else {
+                    step[a] = 0; out[a] = -2;
+                    t_next[a] = t_delta[a] = INF_DOUBLE;
+                }
+            }
+
+            // Per-ray mailbox: objects spanning several cells are intersected once
+            uint32_t mailbox[GRID_MAILBOX_SIZE];
+            std::fill(mailbox, mailbox + GRID_MAILBOX_SIZE, UINT32_MAX);
+
+            while (true) {
+                const uint32_t* begin;
+                const uint32_t* end;
+                cell_items(cell[0], cell[1], cell[2], begin, end);
+                for (const uint32_t* it = begin; it != end; ++it) {
+                    uint32_t& slot = mailbox[*it % GRID_MAILBOX_SIZE];
+                    if (slot == *it)
+                        continue;
+                    slot = *it;
+                    if (primitives[*it]->intersect(r, t_min, t_max, int_pt)) {
+                        hit = true;
+                        t_max = int_pt.t;
+                    }
+                }
+
+                int axis = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+                if (t_max <= t_next[axis] || t_next[axis] > t1)
+                    break;
+                cell[axis] += step[axis];
+                if (cell[axis] == out[axis])
+                    break;
+                t_next[axis] += t_delta[axis];
+            }
+            return hit;
+        }
+
+        std::vector<shared_ptr<Object>> primitives;
+        std::vector<BoundingBox> boxes;
+        std::vector<uint32_t> small;  // objects stored in cells
+        std::vector<uint32_t> large;  // objects tested for every ray
+        BoundingBox full_box;
+        BoundingBox grid_box;
+        bool has_box = false;
+        double median_diagonal = 0;
+        int res[3] = {1, 1, 1};
+        double cell_size[3] = {1, 1, 1};
+        double inv_cell_size[3] = {1, 1, 1};
+};
+
+// Dense uniform grid: resolution from object density (about GRID_DENSITY objects
+// per cell), cell contents in one flat array indexed by per-cell offsets
+class UniformGrid : public GridBase {
+    public:
+        UniformGrid(const std::vector<shared_ptr<Object>>& objects) : GridBase(objects) {
+            if (small.empty())
+                return;
+
+            // Cubic cells with volume = density * grid volume / number of objects
+            Vec3 extent = grid_box.max() - grid_box.min();
+            double volume = 1.0;
+            int flat_axes = 0;
+            for (int a = 0; a < 3; ++a) {
+                if (extent[a] > 1e-9 * extent.length()) volume *= extent[a];
+                else ++flat_axes;
+            }
+            double edge = pow(GRID_DENSITY * volume / small.size(), 1.0 / (3 - std::min(flat_axes, 2)));
+            edge = fmax(edge, cbrt(static_cast<double>(extent.x() * extent.y() * extent.z()) / GRID_MAX_CELLS));
+            set_cell_size(edge, GRID_MAX_RES);
+
+            // Count, prefix-sum, then fill (two passes, no per-cell vectors)
+            size_t cells = static_cast<size_t>(res[0]) * res[1] * res[2];
+            offsets.assign(cells + 1, 0);
+            for (uint32_t i : small)
+                for_each_cell(i, [&](int x, int y, int z) { ++offsets[index(x, y, z) + 1]; });
+            for (size_t c = 0; c < cells; ++c)
+                offsets[c + 1] += offsets[c];
+            items.resize(offsets[cells]);
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (uint32_t i : small)
+                for_each_cell(i, [&](int x, int y, int z) { items[fill[index(x, y, z)]++] = i; });
+        }
+
+        bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            return traverse(r, t_min, t_max, int_pt, [this](int x, int y, int z, const uint32_t*& begin, const uint32_t*& end) {
+                size_t c = index(x, y, z);
+                begin = items.data() + offsets[c];
+                end = items.data() + offsets[c + 1];
+            });
+        }
+
+        size_t num_cells() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+        size_t memory_bytes() const { return offsets.size() * sizeof(uint32_t) + items.size() * sizeof(uint32_t); }
+
+    private:
+        size_t index(int x, int y, int z) const {
+            return (static_cast<size_t>(z) * res[1] + y) * res[0] + x;
+        }
+
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> items;
+};
+
+// Sparse grid: only non-empty cells are stored, in an open-addressing hash table,
+// so cells can follow object size (not scene volume) and empty space costs no memory
+class HashGrid : public GridBase {
+    public:
+        HashGrid(const std::vector<shared_ptr<Object>>& objects) : GridBase(objects) {
+            if (small.empty())
+                return;
+
+            set_cell_size(GRID_HASH_CELL_FACTOR * median_diagonal, GRID_HASH_MAX_RES);
+
+            // Collect (cell key, object) pairs, sort by key, then one table entry per run
+            std::vector<std::pair<uint64_t, uint32_t>> pairs;
+            for (uint32_t i : small)
+                for_each_cell(i, [&](int x, int y, int z) { pairs.push_back(std::make_pair(key(x, y, z), i)); });
+            std::sort(pairs.begin(), pairs.end());
+
+            size_t occupied = 0;
+            for (size_t k = 0; k < pairs.size(); ++k)
+                occupied += (k == 0 || pairs[k].first != pairs[k - 1].first);
+            size_t capacity = 16;
+            while (capacity < 2 * occupied)
+                capacity *= 2;
+            table.assign(capacity, Entry{EMPTY_KEY, 0, 0});
+            mask = capacity - 1;
+
+            items.resize(pairs.size());
+            for (size_t k = 0; k < pairs.size(); ++k) {
+                items[k] = pairs[k].second;
+                if (k > 0 && pairs[k].first == pairs[k - 1].first)
+                    continue;
+                size_t slot = hash(pairs[k].first) & mask;
+                while (table[slot].key != EMPTY_KEY)
+                    slot = (slot + 1) & mask;
+                table[slot] = Entry{pairs[k].first, static_cast<uint32_t>(k), 0};
+                size_t run = k;
+                while (run < pairs.size() && pairs[run].first == pairs[k].first)
+                    ++run;
+                table[slot].end = static_cast<uint32_t>(run);
+            }
+        }
+
+        bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            return traverse(r, t_min, t_max, int_pt, [this](int x, int y, int z, const uint32_t*& begin, const uint32_t*& end) {
+                uint64_t k = key(x, y, z);
+                for (size_t slot = hash(k) & mask; table[slot].key != EMPTY_KEY; slot = (slot + 1) & mask) {
+                    if (table[slot].key == k) {
+                        begin = items.data() + table[slot].begin;
+                        end = items.data() + table[slot].end;
+                        return;
+                    }
+                }
+                begin = end = items.data();
+            });
+        }
+
+        size_t num_cells() const {
+            size_t n = 0;
+            for (const auto& e : table)
+                n += e.key != EMPTY_KEY;
+            return n;
+        }
+        size_t memory_bytes() const { return table.size() * sizeof(Entry) + items.size() * sizeof(uint32_t); }
+
+    private:
+        struct Entry {
+            uint64_t key;
+            uint32_t begin, end;
+        };
+
+        static const uint64_t EMPTY_KEY = ~0ull;
+
+        static uint64_t key(int x, int y, int z) {
+            return static_cast<uint64_t>(x) | (static_cast<uint64_t>(y) << 21) | (static_cast<uint64_t>(z) << 42);
+        }
+
+        static uint64_t hash(uint64_t k) { return mix_seed(k); }
+
+        std::vector<Entry> table;
+        std::vector<uint32_t> items;
+        size_t mask = 0;
+};
+
+#endif
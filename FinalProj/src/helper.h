@@ -1,30 +1,82 @@
 #ifndef _CS418_HELPER_H
 #define _CS418_HELPER_H
 
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+#include "util.h"
+#include "object.h"
+#include "scene.h"
+#include "sphere.h"
+#include "plane.h"
+#include "material.h"
+#include "texture.h"
+#include "instance.h"
+#include "environment.h"
+
+/**
+    Average + gamma-correct a pixel sum into 8-bit values
+    @param Vec3 pixel value (r,g,b) summed over samples
+    @param int samples_per_pixel
+    @param uint8_t[3] output
+*/
+inline void pixel_to_rgb8(Vec3 pixel_color, int samples_per_pixel, uint8_t rgb[3]) {
+    auto scale = 1.0 / samples_per_pixel;
+    for (int k = 0; k < 3; ++k) {
+        double c = pixel_color[k];
+        c = c != c ? 0.0 : c;
+
+        // Gamma Correction, value within [0,255)
+        rgb[k] = static_cast<uint8_t>(256 * clamp(sqrt(scale * c), 0.0, 0.999));
+    }
+}
+
 /**
     Write pixel value to output stream
     @param FILE output_file to write
     @param Vec3 pixel value (r,g,b)
     @param int samples_per_pixel
 */
-void write_pixel_file_line(FILE * output_file, Vec3 pixel_color, int samples_per_pixel) {
-    double r = pixel_color.x(), g = pixel_color.y(), b = pixel_color.z();
-
-    r = r != r ? 0.0 : r;
-    g = g != g ? 0.0 : g;
-    b = b != b ? 0.0 : b;
-    
-    // Gamma Correction
-    auto scale = 1.0 / samples_per_pixel;
-    r = sqrt(scale * r);
-    g = sqrt(scale * g);
-    b = sqrt(scale * b);
+inline void write_pixel_file_line(FILE * output_file, Vec3 pixel_color, int samples_per_pixel) {
+    uint8_t rgb[3];
+    pixel_to_rgb8(pixel_color, samples_per_pixel, rgb);
 
     // Write the pixel value within [0,255) to a new line 
-    fprintf(output_file, "%d %d %d\n", 
-            static_cast<int>(256 * clamp(r, 0.0, 0.999)),
-            static_cast<int>(256 * clamp(g, 0.0, 0.999)),
-            static_cast<int>(256 * clamp(g, 0.0, 0.999)));
+    fprintf(output_file, "%d %d %d\n", rgb[0], rgb[1], rgb[2]);
+}
+
+/**
+    Power heuristic weight for multiple importance sampling
+    @param double pdf of the strategy being weighted
+    @param double pdf of the other strategy
+*/
+inline double mis_weight(double pdf, double other_pdf) {
+    return pdf > 0 ? pdf * pdf / (pdf * pdf + other_pdf * other_pdf) : 0.0;
+}
+
+/**
+    Direct light from the background at a lambertian hit (shadow ray toward a sampled direction)
+
+    @param Intersection hit point
+    @param Vec3 albedo returned by scatter
+    @param Object Scene
+    @param Background importance-sampled background
+*/
+inline Vec3 sample_background_light(const Intersection& rec, const Vec3& albedo, const Object& scene, const Background& background) {
+    double light_pdf;
+    Vec3 dir = background.sample(generate_random_double(), generate_random_double(), light_pdf);
+    double cos_theta = dot(rec.normal, dir);
+    if (light_pdf <= 0 || cos_theta <= 0)
+        return Vec3(0, 0, 0);
+
+    Intersection blocker;
+    if (scene.intersect(Ray(rec.point, dir), 0.001, INF_DOUBLE, blocker))
+        return Vec3(0, 0, 0);
+
+    double bsdf_pdf = cos_theta / PI;
+    Vec3 brdf = albedo * (1.0 / PI);
+    return brdf * background.radiance(dir) * (cos_theta * mis_weight(light_pdf, bsdf_pdf) / light_pdf);
 }
 
 /**
@@ -33,8 +85,10 @@ void write_pixel_file_line(FILE * output_file, Vec3 pixel_color, int samples_per
     @param Ray Given emitted ray
     @param Object Scene
     @param int current depth
+    @param Background radiance for rays leaving the scene
+    @param double pdf of the lambertian bounce that produced r (negative: camera/specular ray)
 */
-Vec3 generate_pixel_color(const Ray& r, const Object& scene, int depth) {
+inline Vec3 generate_pixel_color(const Ray& r, const Object& scene, int depth, const Background& background, double bsdf_pdf = -1) {
     Intersection rec;
 
     // If we've exceeded the ray bounce limit, no more light is gathered.
@@ -44,65 +98,99 @@ Vec3 generate_pixel_color(const Ray& r, const Object& scene, int depth) {
     if (scene.intersect(r, 0.001, INF_DOUBLE, rec)) {
         Ray scattered;
         Vec3 attenuation;
-        if (rec.mat_ptr->scatter(r, rec, attenuation, scattered))
-            return attenuation * generate_pixel_color(scattered, scene, depth - 1);
-        return Vec3(0,0,0);
+        if (!rec.mat_ptr->scatter(r, rec, attenuation, scattered))
+            return Vec3(0,0,0);
+
+        if (background.can_sample() && rec.mat_ptr->is_lambertian()) {
+            // Next event estimation, combined with the bounce below through MIS
+            Vec3 direct = sample_background_light(rec, attenuation, scene, background);
+            double scattered_pdf = fmax(dot(rec.normal, unit_vector(scattered.direction())), 0.0) / PI;
+            return direct + attenuation * generate_pixel_color(scattered, scene, depth - 1, background, scattered_pdf);
+        }
+        return attenuation * generate_pixel_color(scattered, scene, depth - 1, background);
     }
 
     Vec3 unit_direction = unit_vector(r.direction());
-    auto t = 0.5 * (unit_direction.y() + 1.0);
-    return (1.0 - t) * Vec3(1.0, 1.0, 1.0) + t * Vec3(0.4, 0.4, 0.6);
+    Vec3 sky = background.radiance(unit_direction);
+    if (bsdf_pdf >= 0 && background.can_sample())
+        return mis_weight(bsdf_pdf, background.pdf(unit_direction)) * sky;
+    return sky;
 }
 
 /**
-    Generate random sphere with random (size & pos & material)
+    Generate random material of the given type
     @param int enum: 0:diffuse; 1:metal 2:glass
-    @param Vec3 random_position
 */
-shared_ptr<Sphere> generate_random_sphere(int rand_material_type, Vec3 rand_pos) {
+inline shared_ptr<Material> generate_random_material(int rand_material_type) {
     assert(rand_material_type <= 2);
 
-    shared_ptr<Sphere> new_obj;
-    double rand_radius = generate_random_double(0.16, 0.26);
-
     if(rand_material_type == 0) {
         // Diffuse
         auto rand_checker = make_shared<CheckerTexture>(make_shared<Solid>(Vec3::random()), make_shared<Solid>(Vec3::random())); 
-        auto albedo = Vec3::random() * Vec3::random();
-        new_obj = make_shared<Sphere>(rand_pos, rand_radius, make_shared<DiffuseMaterial>(rand_checker));
+        return make_shared<DiffuseMaterial>(rand_checker);
     } else if(rand_material_type == 1) {
         // Metal
         auto albedo = Vec3::random(0.5, 1);
         auto fuzz = generate_random_double(0.2, 0.5);
-        new_obj = make_shared<Sphere>(rand_pos, rand_radius, make_shared<MetalMaterial>(albedo, fuzz));
-    } else {
-        // Glass
-        new_obj = make_shared<Sphere>(rand_pos, rand_radius, make_shared<DielectricsMaterial>(1.5));
+        return make_shared<MetalMaterial>(albedo, fuzz);
     }
-    return new_obj;
+    // Glass
+    return make_shared<DielectricsMaterial>(1.5);
 }
 
 /**
-    Generate random scene given num_of_sphere apply BVH
-    @param int num_of_spheres
+    Generate random sphere with random (size & pos & material)
+    @param int enum: 0:diffuse; 1:metal 2:glass
+    @param Vec3 random_position
 */
-Scene generate_random_scene(int num_of_sphere) {
-    Scene new_scene;
-
-    // Initialize with scene floor
-    auto rand_checker = make_shared<CheckerTexture>(make_shared<Solid>(Vec3(1, 1, 1)), make_shared<Solid>(Vec3(1, 1, 1))); 
-    new_scene.insert_obj(make_shared<Sphere>(Vec3(0, -1000, 0), 1000, make_shared<DiffuseMaterial>(rand_checker)));
+inline shared_ptr<Sphere> generate_random_sphere(int rand_material_type, Vec3 rand_pos) {
+    double rand_radius = generate_random_double(0.16, 0.26);
+    return make_shared<Sphere>(rand_pos, rand_radius, generate_random_material(rand_material_type));
+}
 
-    // Layout setting
-    int horizontal_num = 1, vertical_num = num_of_sphere;
+/**
+    Grid layout (horizontal_num * vertical_num cells) used to place random spheres
+    @param int num_of_spheres
+*/
+inline void generate_scene_layout(int num_of_sphere, int& horizontal_num, int& vertical_num) {
+    horizontal_num = 1;
+    vertical_num = num_of_sphere;
     while(vertical_num >= horizontal_num) {
         horizontal_num *= 2;
         vertical_num /= 2;
     }
     ++vertical_num;
+}
+
+/**
+    Floor of the random scenes: y = 0 plane with a (u, v) checker
+    (squares as large as the 3D checker's, which degenerates on y = 0)
+    @param Texture floor_texture replacing the checker (e.g. an ImageTexture, repeated every world unit)
+*/
+inline shared_ptr<Plane> generate_scene_floor(shared_ptr<Texture> floor_texture = nullptr) {
+    if (!floor_texture)
+        floor_texture = make_shared<CheckerTexture>(make_shared<Solid>(Vec3(1, 1, 1)), make_shared<Solid>(Vec3(1, 1, 1)), 10 / PI);
+    return make_shared<Plane>(Vec3(0, 0, 0), Vec3(0, 1, 0), make_shared<DiffuseMaterial>(floor_texture));
+}
+
+/**
+    Generate random scene given num_of_sphere apply BVH
+    @param int num_of_spheres
+    @param uint64_t seed (same seed gives the same scene)
+    @param Texture floor_texture (nullptr: checker)
+*/
+inline Scene generate_random_scene(int num_of_sphere, uint64_t seed, shared_ptr<Texture> floor_texture = nullptr) {
+    Scene new_scene;
+
+    // Initialize with scene floor (an infinite plane, kept out of the BVH by build_accel)
+    new_scene.insert_obj(generate_scene_floor(floor_texture));
+
+    // Layout setting
+    int horizontal_num, vertical_num;
+    generate_scene_layout(num_of_sphere, horizontal_num, vertical_num);
 
     // Reset random seed
-    srand(time(NULL));
+    seed_random(seed);
 
     // Put randomized spheres into scene
     for(int i = 0, cnt = 0; i < horizontal_num; ++i) {
@@ -117,4 +205,48 @@ Scene generate_random_scene(int num_of_sphere) {
     // return Scene(make_shared<BVH>(new_scene));
 }
 
+/**
+    Generate the same random layout with instancing: every sphere is an instance of
+    one shared unit sphere (transform + material picked from a shared palette)
+    @param int num_of_spheres
+    @param uint64_t seed
+    @param Texture floor_texture (nullptr: checker)
+*/
+inline shared_ptr<TwoLevelBVH> generate_instanced_scene(int num_of_sphere, uint64_t seed, shared_ptr<Texture> floor_texture = nullptr) {
+    auto instanced_scene = make_shared<TwoLevelBVH>();
+
+    // Scene floor is its own geometry
+    Scene floor_geometry(generate_scene_floor(floor_texture));
+    instanced_scene->add_instance(instanced_scene->add_geometry(floor_geometry), Transform());
+
+    // One unit sphere shared by all copies
+    Scene sphere_geometry(make_shared<Sphere>(Vec3(0, 0, 0), 1, make_shared<DiffuseMaterial>(make_shared<Solid>(0.5, 0.5, 0.5))));
+    auto sphere_blas = instanced_scene->add_geometry(sphere_geometry);
+
+    seed_random(seed);
+
+    std::vector<shared_ptr<Material>> palette[3];
+    for(int type = 0; type < 3; ++type) {
+        for(int k = 0; k < INSTANCE_PALETTE_SIZE; ++k) {
+            palette[type].push_back(generate_random_material(type));
+        }
+    }
+
+    int horizontal_num, vertical_num;
+    generate_scene_layout(num_of_sphere, horizontal_num, vertical_num);
+
+    for(int i = 0; i < horizontal_num; ++i) {
+        for(int j = 0; j < vertical_num; ++j) {
+            Vec3 rand_pos(i + 1 * generate_random_double(), generate_random_double(0.1, 0.8), j + 1 * generate_random_double());
+            int rand_material_type = generate_random_int(0, 3);
+            double rand_radius = generate_random_double(0.16, 0.26);
+            auto& mat = palette[rand_material_type][generate_random_int(0, INSTANCE_PALETTE_SIZE)];
+            instanced_scene->add_instance(sphere_blas, Transform::translate(rand_pos) * Transform::scale(rand_radius), mat);
+        }
+    }
+
+    instanced_scene->build();
+    return instanced_scene;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,233 @@
+#ifndef _CS418_IMAGE_H
+#define _CS418_IMAGE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "util.h"
+
+// Linear RGB texel (float so HDR data from .pfm fits as well)
+struct Texel {
+    float r, g, b;
+};
+
+// Image stored tile by tile (8x8 texels, Morton order inside each tile) with a
+// prebuilt mip chain. Neighboring lookups (bilinear footprints, coherent rays
+// from many threads) then land in the same few cache lines.
+class TiledImage {
+    public:
+        static const int TILE_BITS = 3;
+        static const int TILE_SIZE = 1 << TILE_BITS;
+
+        TiledImage() {}
+
+        // texels: row-major, row 0 is the top of the image
+        TiledImage(int width, int height, const std::vector<Texel>& texels) {
+            mips.push_back(make_level(width, height));
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x)
+                    at(mips[0], x, y) = texels[y * width + x];
+
+            // Box-filter down to 1x1. On odd sizes the last column / row of the level
+            // below joins the last texel's footprint (3 texels wide) instead of being dropped
+            while (mips.back().width > 1 || mips.back().height > 1) {
+                const Level& src = mips.back();
+                Level dst = make_level(std::max(1, src.width / 2), std::max(1, src.height / 2));
+                for (int y = 0; y < dst.height; ++y) {
+                    int y0 = 2 * y, y1 = y + 1 == dst.height ? src.height : std::min(y0 + 2, src.height);
+                    for (int x = 0; x < dst.width; ++x) {
+                        int x0 = 2 * x, x1 = x + 1 == dst.width ? src.width : std::min(x0 + 2, src.width);
+                        Texel sum = {0, 0, 0};
+                        for (int sy = y0; sy < y1; ++sy) {
+                            for (int sx = x0; sx < x1; ++sx) {
+                                const Texel& t = fetch(src, sx, sy);
+                                sum.r += t.r; sum.g += t.g; sum.b += t.b;
+                            }
+                        }
+                        float n = static_cast<float>((x1 - x0) * (y1 - y0));
+                        at(dst, x, y) = {sum.r / n, sum.g / n, sum.b / n};
+                    }
+                }
+                mips.push_back(dst);
+            }
+        }
+
+        int levels() const { return static_cast<int>(mips.size()); }
+        int width(int level = 0) const { return mips[level].width; }
+        int height(int level = 0) const { return mips[level].height; }
+
+        // Texel (x, y) of a mip level, coordinates clamped to the edge
+        Vec3 texel(int level, int x, int y) const {
+            const Texel& t = fetch(mips[level], x, y);
+            return Vec3(t.r, t.g, t.b);
+        }
+
+        // Bilinear lookup, (s, t) in [0,1] with t = 0 at the top row
+        Vec3 bilinear(int level, double s, double t) const {
+            const Level& l = mips[level];
+            double x = s * l.width - 0.5, y = t * l.height - 0.5;
+            int x0 = static_cast<int>(floor(x)), y0 = static_cast<int>(floor(y));
+            float fx = static_cast<float>(x - x0), fy = static_cast<float>(y - y0);
+
+            const Texel& a = fetch(l, x0, y0);
+            const Texel& b = fetch(l, x0 + 1, y0);
+            const Texel& c = fetch(l, x0, y0 + 1);
+            const Texel& d = fetch(l, x0 + 1, y0 + 1);
+            float w00 = (1 - fx) * (1 - fy), w10 = fx * (1 - fy), w01 = (1 - fx) * fy, w11 = fx * fy;
+            return Vec3(w00 * a.r + w10 * b.r + w01 * c.r + w11 * d.r,
+                        w00 * a.g + w10 * b.g + w01 * c.g + w11 * d.g,
+                        w00 * a.b + w10 * b.b + w01 * c.b + w11 * d.b);
+        }
+
+        // Trilinear lookup between the two mip levels around lod
+        Vec3 sample(double s, double t, double lod) const {
+            lod = clamp(lod, 0.0, levels() - 1.0);
+            int l0 = static_cast<int>(lod);
+            double f = lod - l0;
+            if (f == 0.0 || l0 + 1 >= levels())
+                return bilinear(l0, s, t);
+            return (1 - f) * bilinear(l0, s, t) + f * bilinear(l0 + 1, s, t);
+        }
+
+    private:
+        struct Level {
+            int width, height, tiles_x;
+            std::vector<Texel> texels;
+        };
+
+        static Level make_level(int width, int height) {
+            Level l;
+            l.width = width;
+            l.height = height;
+            l.tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+            int tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+            l.texels.resize(static_cast<size_t>(l.tiles_x) * tiles_y * TILE_SIZE * TILE_SIZE);
+            return l;
+        }
+
+        // Spread the 3 low bits of v to even bit positions
+        static int part_bits(int v) {
+            return (v & 1) | ((v & 2) << 1) | ((v & 4) << 2);
+        }
+
+        static size_t tiled_index(const Level& l, int x, int y) {
+            size_t tile = static_cast<size_t>(y >> TILE_BITS) * l.tiles_x + (x >> TILE_BITS);
+            int in_tile = part_bits(x & (TILE_SIZE - 1)) | (part_bits(y & (TILE_SIZE - 1)) << 1);
+            return (tile << (2 * TILE_BITS)) + in_tile;
+        }
+
+        static Texel& at(Level& l, int x, int y) {
+            return l.texels[tiled_index(l, x, y)];
+        }
+
+        static const Texel& fetch(const Level& l, int x, int y) {
+            x = x < 0 ? 0 : (x >= l.width ? l.width - 1 : x);
+            y = y < 0 ? 0 : (y >= l.height ? l.height - 1 : y);
+            return l.texels[tiled_index(l, x, y)];
+        }
+
+        std::vector<Level> mips;
+};
+
+// Skip whitespace and '#' comment lines between the fields of a ppm / pfm header
+inline void skip_header_comments(FILE* file) {
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '#') {
+            while ((c = fgetc(file)) != EOF && c != '\n')
+                ;
+        } else if (!isspace(c)) {
+            ungetc(c, file);
+            return;
+        }
+    }
+}
+
+/**
+    Load .ppm (P3/P6, gamma 2 like our output) or .pfm (linear float) image
+    @param string path
+    @return nullptr when the file can't be read
+*/
+inline shared_ptr<TiledImage> load_image(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return nullptr;
+
+    char magic[3] = {0, 0, 0};
+    int width = 0, height = 0;
+    double max_value = 0;
+    bool header_ok = fscanf(file, "%2s", magic) == 1;
+    skip_header_comments(file);
+    header_ok = header_ok && fscanf(file, "%d", &width) == 1;
+    skip_header_comments(file);
+    header_ok = header_ok && fscanf(file, "%d", &height) == 1;
+    skip_header_comments(file);
+    header_ok = header_ok && fscanf(file, "%lf", &max_value) == 1;
+    if (!header_ok || width <= 0 || height <= 0) {
+        fclose(file);
+        return nullptr;
+    }
+    fgetc(file); // Single whitespace before binary data
+
+    std::vector<Texel> texels(static_cast<size_t>(width) * height);
+    bool ok = true;
+    if (strcmp(magic, "PF") == 0) {
+        // Rows stored bottom to top, negative scale means little endian
+        bool little_endian = max_value < 0;
+        uint16_t probe = 1;
+        bool host_little = *reinterpret_cast<uint8_t*>(&probe) == 1;
+        std::vector<float> row(3 * width);
+        for (int y = height - 1; ok && y >= 0; --y) {
+            ok = fread(row.data(), sizeof(float), row.size(), file) == row.size();
+            for (int x = 0; ok && x < width; ++x) {
+                for (int c = 0; c < 3; ++c) {
+                    float& f = row[3 * x + c];
+                    if (little_endian != host_little) {
+                        uint8_t* bytes = reinterpret_cast<uint8_t*>(&f);
+                        std::swap(bytes[0], bytes[3]);
+                        std::swap(bytes[1], bytes[2]);
+                    }
+                }
+                texels[y * width + x] = {row[3 * x], row[3 * x + 1], row[3 * x + 2]};
+            }
+        }
+    } else if (strcmp(magic, "P6") == 0 || strcmp(magic, "P3") == 0) {
+        bool binary = magic[1] == '6';
+        int bytes = max_value > 255 ? 2 : 1;
+        for (size_t i = 0; ok && i < texels.size(); ++i) {
+            float c[3];
+            for (int k = 0; ok && k < 3; ++k) {
+                int value = 0;
+                if (!binary) {
+                    ok = fscanf(file, "%d", &value) == 1;
+                } else {
+                    for (int b = 0; ok && b < bytes; ++b) {
+                        int byte = fgetc(file);
+                        ok = byte != EOF;
+                        value = (value << 8) | byte;
+                    }
+                }
+                // Undo gamma 2
+                float linear = static_cast<float>(value / max_value);
+                c[k] = linear * linear;
+            }
+            texels[i] = {c[0], c[1], c[2]};
+        }
+    } else {
+        ok = false;
+    }
+    fclose(file);
+
+    if (!ok) {
+        std::cerr << "Failed to read image: " << path << std::endl;
+        return nullptr;
+    }
+    return make_shared<TiledImage>(width, height, texels);
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef _CS418_INSTANCE_H
+#define _CS418_INSTANCE_H
+
+#include <cassert>
+#include <vector>
+
+#include "util.h"
+#include "object.h"
+#include "scene.h"
+#include "bvh.h"
+#include "accel.h"
+#include "transform.h"
+
+// Placement of shared geometry in the world: geometry (usually a bottom-level BVH)
+// is referenced, never copied, so an instance only costs its transform
+class Instance : public Object {
+    public:
+        Instance() {}
+        Instance(shared_ptr<Object> geo, const Transform& xf, shared_ptr<Material> mat = nullptr)
+            : geometry(geo), mat_override(mat) { set_transform(xf); }
+
+        void set_transform(const Transform& xf) {
+            transform = xf;
+            BoundingBox local_box;
+            has_box = geometry->get_bbox(local_box);
+            if (has_box)
+                bbox = transform.box(local_box);
+        }
+
+        const Transform& get_transform() const { return transform; }
+
+        bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            // Direction is not normalized so t is the same in both spaces
+            // The cone keeps its angle, so footprints come out in local units (uniform scales)
+            Ray local_ray(transform.inverse_point(r.origin()), transform.inverse_vector(r.direction()), r.spread());
+            if (!geometry->intersect(local_ray, t_min, t_max, int_pt))
+                return false;
+
+            // Front/back face is preserved by the inverse-transpose, only re-express in world space
+            int_pt.point = r.at(int_pt.t);
+            int_pt.normal = unit_vector(transform.normal(int_pt.normal));
+            if (mat_override)
+                int_pt.mat_ptr = mat_override;
+            return true;
+        }
+
+        bool get_bbox(BoundingBox& output_box) const {
+            output_box = bbox;
+            return has_box;
+        }
+
+    private:
+        shared_ptr<Object> geometry;
+        shared_ptr<Material> mat_override;
+        Transform transform;
+        BoundingBox bbox;
+        bool has_box;
+};
+
+// Two-level acceleration structure: a top-level BVH over instances and one
+// bottom-level BVH per unique geometry. Moving instances only rebuilds the top level.
+class TwoLevelBVH : public Object {
+    public:
+        TwoLevelBVH() {}
+
+        // Build the bottom-level structure of a geometry once; pass the result to add_instance
+        shared_ptr<Object> add_geometry(Scene& geometry) {
+            shared_ptr<Object> blas = geometry.objects.size() == 1 ? geometry.objects[0] : make_shared<BVH>(geometry);
+            geometries.push_back(blas);
+            return blas;
+        }
+
+        int add_instance(shared_ptr<Object> blas, const Transform& xf, shared_ptr<Material> mat = nullptr) {
+            instances.push_back(make_shared<Instance>(blas, xf, mat));
+            dirty = true;
+            return static_cast<int>(instances.size()) - 1;
+        }
+
+        // Call build() after moving instances
+        void set_transform(int index, const Transform& xf) {
+            instances[index]->set_transform(xf);
+            dirty = true;
+        }
+
+        size_t num_instances() const { return instances.size(); }
+        size_t num_geometries() const { return geometries.size(); }
+
+        // (Re)build the top-level BVH only (unbounded instances are kept beside it)
+        void build() {
+            top.reset();
+            dirty = false;
+            if (instances.empty())
+                return;
+
+            std::vector<shared_ptr<Object>> top_objects(instances.begin(), instances.end());
+            top = build_accel(top_objects, ACCEL_BVH);
+        }
+
+        bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            assert(!dirty && "TwoLevelBVH used before build()");
+            return top && top->intersect(r, t_min, t_max, int_pt);
+        }
+
+        bool get_bbox(BoundingBox& output_box) const {
+            return top && top->get_bbox(output_box);
+        }
+
+    private:
+        std::vector<shared_ptr<Instance>> instances;
+        std::vector<shared_ptr<Object>> geometries;
+        shared_ptr<Object> top;
+        bool dirty = false;
+};
+
+#endif
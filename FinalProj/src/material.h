@@ -2,14 +2,32 @@
 #define _CS418_MATERIAL_H
 
 #include "util.h"
+#include "object.h"
 #include "texture.h"
 
-// Forward Declaration
-struct Intersection;
+enum MaterialKind : uint32_t {
+    MATERIAL_DIFFUSE = 0,
+    MATERIAL_METAL = 1,
+    MATERIAL_DIELECTRIC = 2
+};
+
+// Pointer-free description of a material (see scene_cache.h)
+struct MaterialRecord {
+    uint32_t kind;
+    uint32_t texture;   // diffuse: index in the texture table
+    double albedo[3];   // metal
+    double param;       // metal: fuzz, dielectric: refractive index
+};
 
 class Material {
     public:
         virtual bool scatter(const Ray& r_in, const Intersection& int_pt, Vec3& attenuation, Ray& scattered) const = 0;
+
+        // Cosine-weighted scattering: allows direct sampling of the background
+        virtual bool is_lambertian() const { return false; }
+
+        // Fill record (textures are appended to the table); false if it can't be described
+        virtual bool describe(std::vector<TextureRecord>& textures, MaterialRecord& record) const { return false; }
 };
 
 class DiffuseMaterial : public Material {
@@ -20,10 +38,18 @@ class DiffuseMaterial : public Material {
         virtual bool scatter(const Ray& r_in, const Intersection& int_pt, Vec3& attenuation, Ray& scattered) const  {
             Vec3 scatter_direction = int_pt.normal + generate_random_unit_vec();
             scattered = Ray(int_pt.point, scatter_direction);
-            attenuation = albedo -> value(int_pt.u, int_pt.v, int_pt.point);
+            attenuation = albedo -> value(int_pt.u, int_pt.v, int_pt.point, int_pt.uv_footprint);
             return true;
         }
 
+        bool is_lambertian() const { return true; }
+
+        bool describe(std::vector<TextureRecord>& textures, MaterialRecord& record) const {
+            record = MaterialRecord();
+            record.kind = MATERIAL_DIFFUSE;
+            return albedo -> describe(textures, record.texture);
+        }
+
     private:
         shared_ptr<Texture> albedo; // Only support Solid color
 };
@@ -40,6 +66,15 @@ class MetalMaterial : public Material {
             return (dot(scattered.direction(), int_pt.normal) > 0);
         }
 
+        bool describe(std::vector<TextureRecord>& textures, MaterialRecord& record) const {
+            record = MaterialRecord();
+            record.kind = MATERIAL_METAL;
+            for (int k = 0; k < 3; ++k)
+                record.albedo[k] = albedo[k];
+            record.param = fuzz;
+            return true;
+        }
+
     private:
         Vec3 albedo;
         double fuzz;
@@ -74,9 +109,34 @@ class DielectricsMaterial : public Material {
             scattered = Ray(int_pt.point, refracted);
             return true;
         }
+
+        bool describe(std::vector<TextureRecord>& textures, MaterialRecord& record) const {
+            record = MaterialRecord();
+            record.kind = MATERIAL_DIELECTRIC;
+            record.param = refractive_index;
+            return true;
+        }
         
     private:
         double refractive_index;
 };
 
-#endif
\ No newline at end of file
+/**
+    Rebuild a material from its record
+    @param MaterialRecord record
+    @param TextureRecord* texture table of num_textures records
+    @return nullptr for an invalid record
+*/
+inline shared_ptr<Material> make_material(const MaterialRecord& record, const TextureRecord* textures, uint32_t num_textures) {
+    if (record.kind == MATERIAL_DIFFUSE) {
+        auto texture = make_texture(textures, num_textures, record.texture);
+        return texture ? make_shared<DiffuseMaterial>(texture) : nullptr;
+    }
+    if (record.kind == MATERIAL_METAL)
+        return make_shared<MetalMaterial>(Vec3(record.albedo[0], record.albedo[1], record.albedo[2]), record.param);
+    if (record.kind == MATERIAL_DIELECTRIC)
+        return make_shared<DielectricsMaterial>(record.param);
+    return nullptr;
+}
+
+#endif
@@ -17,6 +17,7 @@ struct Intersection {
     bool is_front_face;
     double t;
     double u, v; // Surface coordinate
+    double uv_footprint = 0; // Width of the ray cone in (u, v) units, 0: unknown
 
     // Determine at geomergy time
     inline void set_face_normal(const Ray& r, const Vec3& outward_normal) {
@@ -0,0 +1,267 @@
+#ifndef _CS418_OPTIONS_H
+#define _CS418_OPTIONS_H
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+#include "util.h"
+#include "accel.h"
+#include "render.h"
+#include "temporal.h"
+
+// Command line settings: [num_of_sphere] [output_file_name] [max_bounce_depth] [--flags]
+struct RenderOptions {
+    int num_of_sphere = DEFAULT_SPHERE_NUM;
+    const char* file_name = DEFAULT_NAME;
+    int max_depth = RAY_BOUNCE_DEPTH_LIMIT;
+    int width = 0;              // --width <px> (default IMAGE_WIDTH)
+    int height = 0;             // --height <px> (default width / ASPECT_RADIO)
+
+    bool instanced = false;     // --instanced: shared sphere geometry on a two-level BVH
+    char* envmap_dir = nullptr; // --envmap <dir>: cube-map background (.ppm/.pfm faces)
+    double env_intensity = 1.0; // --env-intensity <scale>
+    char* floor_texture = nullptr; // --floor-texture <image>: mip-mapped .ppm/.pfm on the floor, one copy per world unit
+    AccelType accel = ACCEL_BVH; // --accel none|bvh|wide4|wide8|grid|hashgrid
+    bool bench = false;         // --bench: compare acceleration structures and exit
+    bool bench_layouts = false; // --bench-layouts: same over sphere counts and layouts
+    uint64_t seed = 0;          // --seed <n>: scene / sampling seed (default: time)
+    int num_threads = 0;        // --threads <n> (0, the default: all cores)
+    int samples_per_pixel = NUM_OF_SAMPLES_PER_PIXEL; // --spp <n> (--progressive: 0 for no sample limit)
+
+    bool progressive = false;   // --progressive: 1 spp passes with preview images
+    double time_budget = 0;     // --time-budget <seconds>
+    double noise_target = 0;    // --noise-target <relative error>
+    double write_interval = PREVIEW_WRITE_INTERVAL; // --write-interval <seconds>
+    int write_every = 0;        // --write-every <passes>
+    char* checkpoint_file = nullptr; // --checkpoint <file>: periodic checkpoints of a progressive render
+    double checkpoint_interval = CHECKPOINT_INTERVAL; // --checkpoint-interval <seconds>
+    char* resume_file = nullptr;     // --resume <file>: continue from a checkpoint (implies --progressive)
+    char* views_file = nullptr;      // --views <file>: batch render of many cameras (see batch.h)
+    char* scene_cache = nullptr;     // --scene-cache <file>: trace a mapped scene cache instead of generating the scene
+    char* write_scene_cache = nullptr; // --write-scene-cache <file>: save the generated scene + BVH for --scene-cache
+    int animate_frames = 0;          // --animate <frames>: orbit the camera, reusing samples between frames
+    double orbit_degrees = TEMPORAL_ORBIT_DEGREES; // --orbit <degrees> covered by the whole animation
+    bool temporal_reuse = true;      // --no-reuse: render every frame from scratch (for comparison)
+    bool radiance_cache = false;     // --radiance-cache: end diffuse paths early in a shared radiance cache
+    int cache_memory = RADIANCE_CACHE_MEMORY;        // --cache-size <MB>
+    double cache_cell_size = RADIANCE_CACHE_CELL_SIZE; // --cache-cell-size <world units>
+    double cache_spread = RADIANCE_CACHE_SPREAD;     // --cache-spread <fraction>: footprint area ratio to the primary hit's, smaller ends paths earlier
+    bool out_of_core = false;        // --out-of-core: render bands straight into the output file
+    int memory_budget = OUT_OF_CORE_MEMORY_BUDGET; // --memory-budget <MB> of --out-of-core
+};
+
+// Flags followed by a value
+inline bool option_takes_value(const char* flag) {
+    static const char* const flags[] = {
+        "--width", "--height", "--envmap", "--env-intensity", "--floor-texture", "--accel", "--seed", "--threads", "--spp",
+        "--time-budget", "--noise-target", "--write-interval", "--write-every", "--checkpoint",
+        "--checkpoint-interval", "--views", "--scene-cache", "--write-scene-cache", "--animate",
+        "--orbit", "--cache-size", "--cache-cell-size", "--cache-spread", "--memory-budget", "--resume"
+    };
+    for (const char* name : flags) {
+        if (strcmp(flag, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+    Parse positional parameters followed by optional --flags
+    @param int argc
+    @param char** argv
+    @return false on an unknown flag
+*/
+inline bool parse_options(int argc, char* argv[], RenderOptions& options) {
+    int positional = 0;
+    bool accel_given = false;
+    for (int i = 1; i < argc; ++i) {
+        if (option_takes_value(argv[i]) && i + 1 >= argc) {
+            std::cerr << "Missing value for " << argv[i] << std::endl;
+            return false;
+        }
+        if (strncmp(argv[i], "--", 2) != 0) {
+            if (positional == 0) options.num_of_sphere = atoi(argv[i]);
+            else if (positional == 1) options.file_name = argv[i];
+            else if (positional == 2) options.max_depth = atoi(argv[i]);
+            ++positional;
+        } else if (strcmp(argv[i], "--width") == 0) {
+            options.width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--height") == 0) {
+            options.height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--instanced") == 0) {
+            options.instanced = true;
+        } else if (strcmp(argv[i], "--envmap") == 0) {
+            options.envmap_dir = argv[++i];
+        } else if (strcmp(argv[i], "--env-intensity") == 0) {
+            options.env_intensity = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--floor-texture") == 0) {
+            options.floor_texture = argv[++i];
+        } else if (strcmp(argv[i], "--accel") == 0) {
+            accel_given = true;
+            if (!parse_accel_type(argv[++i], options.accel)) {
+                std::cerr << "Unknown acceleration structure: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            options.bench = true;
+        } else if (strcmp(argv[i], "--bench-layouts") == 0) {
+            options.bench_layouts = true;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            options.num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--spp") == 0) {
+            options.samples_per_pixel = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--progressive") == 0) {
+            options.progressive = true;
+        } else if (strcmp(argv[i], "--time-budget") == 0) {
+            options.time_budget = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--noise-target") == 0) {
+            options.noise_target = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--write-interval") == 0) {
+            options.write_interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--write-every") == 0) {
+            options.write_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint") == 0) {
+            options.checkpoint_file = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint-interval") == 0) {
+            options.checkpoint_interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--views") == 0) {
+            options.views_file = argv[++i];
+        } else if (strcmp(argv[i], "--scene-cache") == 0) {
+            options.scene_cache = argv[++i];
+        } else if (strcmp(argv[i], "--write-scene-cache") == 0) {
+            options.write_scene_cache = argv[++i];
+        } else if (strcmp(argv[i], "--animate") == 0) {
+            options.animate_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--orbit") == 0) {
+            options.orbit_degrees = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-reuse") == 0) {
+            options.temporal_reuse = false;
+        } else if (strcmp(argv[i], "--radiance-cache") == 0) {
+            options.radiance_cache = true;
+        } else if (strcmp(argv[i], "--cache-size") == 0) {
+            options.cache_memory = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cache-cell-size") == 0) {
+            options.cache_cell_size = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--cache-spread") == 0) {
+            options.cache_spread = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--out-of-core") == 0) {
+            options.out_of_core = true;
+        } else if (strcmp(argv[i], "--memory-budget") == 0) {
+            options.memory_budget = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            options.resume_file = argv[++i];
+            options.progressive = true;
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return false;
+        }
+    }
+
+    // Missing dimensions follow the default aspect ratio
+    if (options.width <= 0) {
+        options.width = options.height > 0 ? static_cast<int>(options.height * ASPECT_RADIO) : IMAGE_WIDTH;
+    }
+    if (options.height <= 0) {
+        options.height = std::max(1, static_cast<int>(options.width / ASPECT_RADIO));
+    }
+    if (options.samples_per_pixel < 0 || (options.samples_per_pixel == 0 && !options.progressive)) {
+        std::cerr << "--spp must be positive (--progressive: 0 for no sample limit)" << std::endl;
+        return false;
+    }
+    if (options.num_threads < 0) {
+        std::cerr << "--threads must be positive (0: all cores)" << std::endl;
+        return false;
+    }
+    if (options.memory_budget <= 0) {
+        options.memory_budget = OUT_OF_CORE_MEMORY_BUDGET;
+    }
+    if (options.out_of_core && (options.progressive || options.views_file)) {
+        std::cerr << "--out-of-core can't be combined with --progressive / --resume / --views" << std::endl;
+        return false;
+    }
+
+    if (options.views_file && (options.progressive || options.checkpoint_file || options.bench || options.bench_layouts)) {
+        // Views are rendered once at --spp, without passes or checkpoints
+        std::cerr << "--views can't be combined with --progressive / --checkpoint / --resume / --bench / --bench-layouts" << std::endl;
+        return false;
+    }
+
+    std::string frame_prefix, frame_suffix;
+    int frame_width;
+    if (options.animate_frames > 0 && strchr(options.file_name, '%') &&
+        !parse_frame_pattern(options.file_name, frame_prefix, frame_suffix, frame_width)) {
+        std::cerr << "--animate output names take exactly one %d / %0Nd, N <= " << FRAME_NUMBER_MAX_WIDTH << " (\"%%\" for a literal %)" << std::endl;
+        return false;
+    }
+    if (options.animate_frames > 0 && (options.progressive || options.views_file || options.out_of_core)) {
+        std::cerr << "--animate can't be combined with --progressive / --resume / --views / --out-of-core" << std::endl;
+        return false;
+    }
+    if (options.radiance_cache && (options.checkpoint_file || options.resume_file)) {
+        // The cache isn't saved, and its contents depend on thread timing
+        std::cerr << "--radiance-cache can't be combined with --checkpoint / --resume" << std::endl;
+        return false;
+    }
+    if (options.cache_memory <= 0 || options.cache_cell_size <= 0 || options.cache_spread < 0) {
+        std::cerr << "--cache-size / --cache-cell-size must be positive, --cache-spread non-negative" << std::endl;
+        return false;
+    }
+    if (options.scene_cache && (accel_given || options.bench || options.bench_layouts || options.write_scene_cache)) {
+        // The mapped scene brings its own BVH and isn't generated
+        std::cerr << "--scene-cache can't be combined with --accel / --bench / --bench-layouts / --write-scene-cache" << std::endl;
+        return false;
+    }
+    if (options.floor_texture && (options.scene_cache || options.write_scene_cache)) {
+        std::cerr << "Scene caches hold solid / checker textures only (no --floor-texture)" << std::endl;
+        return false;
+    }
+    if (options.instanced && (options.scene_cache || options.write_scene_cache)) {
+        std::cerr << "Scene caches hold flat scenes only (no --instanced)" << std::endl;
+        return false;
+    }
+
+    if (options.seed == 0) {
+        options.seed = static_cast<uint64_t>(time(NULL));
+    }
+    if (options.num_threads <= 0) {
+        options.num_threads = default_thread_count();
+    }
+
+    // Keep checkpointing into the file we resume from
+    if (options.resume_file && !options.checkpoint_file) {
+        options.checkpoint_file = options.resume_file;
+    }
+
+    if (positional < 3 && !options.resume_file) {
+        std::cout << "Parameters required, use default instead!!\n [Usage: ./ray_tracer + num_of_sphere + output_file_name + max_bounce_depth]" << std::endl;
+    }
+    return true;
+}
+
+/**
+    Hash of the settings that change the image but are not stored in a checkpoint header
+    (background, floor texture, scene cache), so resuming with different ones can be refused
+*/
+inline uint64_t render_config_hash(const RenderOptions& options) {
+    uint64_t hash = mix_seed(options.envmap_dir ? 1 : 0);
+    for (const char* c = options.envmap_dir; c && *c; ++c) {
+        hash = mix_seed(hash ^ static_cast<unsigned char>(*c));
+    }
+    uint64_t intensity_bits;
+    memcpy(&intensity_bits, &options.env_intensity, sizeof(intensity_bits));
+    hash = mix_seed(hash ^ intensity_bits);
+    for (const char* c = options.scene_cache; c && *c; ++c) {
+        hash = mix_seed(hash ^ static_cast<unsigned char>(*c));
+    }
+    for (const char* c = options.floor_texture; c && *c; ++c) {
+        hash = mix_seed(hash ^ static_cast<unsigned char>(*c));
+    }
+    return hash;
+}
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef _CS418_OUTOFCORE_H
+#define _CS418_OUTOFCORE_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "platform.h"
+#ifndef CS418_HAS_MMAP
+#include <fstream>
+#endif
+
+#include "util.h"
+#include "helper.h"
+#include "renderer.h"
+
+// Image file written band by band without ever holding the whole image:
+// binary P6 (gamma-corrected 8 bit), or PFM (linear float) for *.pfm names.
+// Each band is converted straight into a memory-mapped window of the file
+// (plain seek + write where mmap is not available). The image is written to
+// path.tmp and only appears under its name once commit() succeeds.
+class ImageFileWriter {
+    public:
+        ImageFileWriter() {}
+        ~ImageFileWriter() { abort(); }
+
+        ImageFileWriter(const ImageFileWriter&) = delete;
+        ImageFileWriter& operator=(const ImageFileWriter&) = delete;
+
+        /**
+            Create the file at its final size (written to path.tmp, renamed by commit())
+            @param string path
+            @param bool pfm: float output instead of P6
+            @return false on I/O error
+        */
+        bool open(const std::string& path, int image_width, int image_height, bool pfm) {
+            final_path = path;
+            temp_path = path + ".tmp";
+            width = image_width;
+            height = image_height;
+            is_pfm = pfm;
+            pixel_bytes = is_pfm ? 3 * sizeof(float) : 3;
+
+            // PFM: negative scale = little endian, rows stored bottom to top
+            char header[64];
+            int header_len = is_pfm ? snprintf(header, sizeof(header), "PF\n%d %d\n-1.0\n", width, height)
+                                    : snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+            header_size = header_len;
+            unsigned long long file_size = header_size + static_cast<unsigned long long>(width) * height * pixel_bytes;
+
+#ifdef CS418_HAS_MMAP
+            fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+                return false;
+            if (ftruncate(fd, static_cast<off_t>(file_size)) != 0 ||
+                pwrite(fd, header, header_size, 0) != static_cast<ssize_t>(header_size)) {
+                abort();
+                return false;
+            }
+#else
+            file.open(temp_path.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+            if (!file)
+                return false;
+            file.write(header, header_size);
+            file.seekp(static_cast<std::streamoff>(file_size - 1));
+            file.put(0);
+            if (!file) {
+                abort();
+                return false;
+            }
+#endif
+            return true;
+        }
+
+        /**
+            Store rows [y, y + rows) of the image
+            @param float* linear RGB, 3 floats per pixel, top row first
+            @return false on I/O error
+        */
+        bool write_rows(int y, int rows, const float* rgb) {
+            // Rows of a band are contiguous in the file (in reverse order for PFM)
+            int first_file_row = is_pfm ? height - y - rows : y;
+            size_t row_bytes = static_cast<size_t>(width) * pixel_bytes;
+            unsigned long long begin = header_size + static_cast<unsigned long long>(first_file_row) * row_bytes;
+            size_t length = rows * row_bytes;
+
+#ifdef CS418_HAS_MMAP
+            if (fd < 0)
+                return false;
+            // Map a page-aligned window around the band only
+            unsigned long long page = static_cast<unsigned long long>(sysconf(_SC_PAGESIZE));
+            unsigned long long aligned = begin / page * page;
+            size_t window = length + (begin - aligned);
+            void* mapping = mmap(nullptr, window, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(aligned));
+            if (mapping == MAP_FAILED)
+                return false;
+            convert_rows(rows, rgb, static_cast<char*>(mapping) + (begin - aligned));
+            return munmap(mapping, window) == 0;
+#else
+            if (!file.is_open())
+                return false;
+            std::vector<char> buffer(length);
+            convert_rows(rows, rgb, buffer.data());
+            file.seekp(static_cast<std::streamoff>(begin));
+            file.write(buffer.data(), length);
+            return static_cast<bool>(file);
+#endif
+        }
+
+        // Flush, close and move the complete file to its final name
+        bool commit() {
+            if (!is_open())
+                return false;
+            if (!close_file() || rename(temp_path.c_str(), final_path.c_str()) != 0) {
+                remove(temp_path.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        // Close and delete the unfinished file (nothing is published)
+        void abort() {
+            if (!is_open())
+                return;
+            close_file();
+            remove(temp_path.c_str());
+        }
+
+    private:
+        bool is_open() const {
+#ifdef CS418_HAS_MMAP
+            return fd >= 0;
+#else
+            return file.is_open();
+#endif
+        }
+
+        bool close_file() {
+#ifdef CS418_HAS_MMAP
+            bool ok = ::close(fd) == 0;
+            fd = -1;
+            return ok;
+#else
+            file.close();
+            return !file.fail();
+#endif
+        }
+
+        void convert_rows(int rows, const float* rgb, char* out) const {
+            size_t row_bytes = static_cast<size_t>(width) * pixel_bytes;
+            for (int r = 0; r < rows; ++r) {
+                const float* src = rgb + 3 * static_cast<size_t>(r) * width;
+                char* dst = out + (is_pfm ? rows - 1 - r : r) * row_bytes;
+                if (is_pfm) {
+                    for (size_t k = 0; k < 3 * static_cast<size_t>(width); ++k) {
+                        float c = src[k] == src[k] ? src[k] : 0.0f;
+                        memcpy(dst + k * sizeof(float), &c, sizeof(float));
+                    }
+                } else {
+                    for (int x = 0; x < width; ++x)
+                        pixel_to_rgb8(Vec3(src[3 * x], src[3 * x + 1], src[3 * x + 2]), 1, reinterpret_cast<uint8_t*>(dst + 3 * x));
+                }
+            }
+        }
+
+        std::string final_path;
+        std::string temp_path;
+        int width = 0, height = 0;
+        bool is_pfm = false;
+        size_t pixel_bytes = 3;
+        size_t header_size = 0;
+#ifdef CS418_HAS_MMAP
+        int fd = -1;
+#else
+        std::fstream file;
+#endif
+};
+
+/**
+    Rows per band so the band's float buffer plus its file window fit in the budget
+    @param size_t memory_budget in bytes
+*/
+inline int out_of_core_band_rows(int width, int height, size_t memory_budget, bool pfm) {
+    size_t row_bytes = static_cast<size_t>(width) * (3 * sizeof(float) + (pfm ? 3 * sizeof(float) : 3));
+    size_t rows = memory_budget / std::max<size_t>(row_bytes, 1);
+    return static_cast<int>(std::max<size_t>(1, std::min<size_t>(rows, height)));
+}
+
+/**
+    Render the whole image band by band into an image file: working memory is
+    one band (bounded by memory_budget) whatever the resolution
+    @param Renderer configured with the image size
+    @param char* file_name (*.pfm: float output, otherwise binary P6)
+    @param size_t memory_budget in bytes
+    @return false on I/O error
+*/
+inline bool render_out_of_core(Renderer& renderer, const char* file_name, size_t memory_budget) {
+    const RenderSettings& settings = renderer.get_settings();
+    std::string name(file_name);
+    bool pfm = name.size() > 4 && name.compare(name.size() - 4, 4, ".pfm") == 0;
+
+    ImageFileWriter writer;
+    if (!writer.open(name, settings.width, settings.height, pfm)) {
+        std::cerr << "Can't create " << name << std::endl;
+        return false;
+    }
+
+    int band_rows = out_of_core_band_rows(settings.width, settings.height, memory_budget, pfm);
+    std::vector<float> band(3 * static_cast<size_t>(settings.width) * band_rows);
+    std::cout << "Out-of-core render: bands of " << band_rows << " rows ("
+              << band.size() * sizeof(float) / 1024 << " KB)" << std::endl;
+
+    for (int y = 0; y < settings.height; y += band_rows) {
+        RenderRegion region = {0, y, settings.width, std::min(band_rows, settings.height - y)};
+        if (!renderer.render(band.data(), 0, region) || !writer.write_rows(y, region.height, band.data())) {
+            std::cerr << "\nFailed to render / write rows " << y << " of " << name << std::endl;
+            writer.abort();
+            return false;
+        }
+        std::cout << "\rWriting line finishes: " << settings.height - y - region.height << std::flush;
+    }
+    return writer.commit();
+}
+
+#endif
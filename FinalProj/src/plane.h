@@ -0,0 +1,52 @@
+#ifndef _CS418_PLANE_H
+#define _CS418_PLANE_H
+
+#include "util.h"
+#include "object.h"
+
+// Infinite plane through a point. It has no bounding box, so acceleration
+// structures keep it outside their hierarchy (see build_accel).
+// u, v are world-space distances along a tangent basis of the plane.
+class Plane : public Object {
+    public:
+        Plane() {}
+
+        Plane(Vec3 p, Vec3 n, shared_ptr<Material> m) : point(p), normal(unit_vector(n)), mat_ptr(m) {
+            Vec3 axis = fabs(normal.x()) > 0.9 ? Vec3(0, 1, 0) : Vec3(1, 0, 0);
+            tangent = unit_vector(cross(axis, normal));
+            bitangent = cross(normal, tangent);
+        }
+
+        bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            double denom = dot(normal, r.direction());
+            if (fabs(denom) < 1e-12)
+                return false;
+
+            double t = dot(point - r.origin(), normal) / denom;
+            if (t >= t_max || t <= t_min)
+                return false;
+
+            int_pt.t = t;
+            int_pt.point = r.at(t);
+            int_pt.set_face_normal(r, normal);
+            Vec3 offset = int_pt.point - point;
+            int_pt.u = dot(offset, tangent);
+            int_pt.v = dot(offset, bitangent);
+            int_pt.uv_footprint = r.footprint(t);
+            int_pt.mat_ptr = mat_ptr;
+            return true;
+        }
+
+        bool get_bbox(BoundingBox& output_box) const {
+            return false;
+        }
+
+    public:
+        Vec3 point;
+        Vec3 normal;
+        Vec3 tangent;
+        Vec3 bitangent;
+        shared_ptr<Material> mat_ptr;
+};
+
+#endif
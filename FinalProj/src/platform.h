@@ -0,0 +1,14 @@
+#ifndef _CS418_PLATFORM_H
+#define _CS418_PLATFORM_H
+
+// Memory-mapped files (out-of-core output, scene cache) where POSIX mmap exists;
+// users of CS418_HAS_MMAP fall back to plain stream I/O elsewhere
+#if defined(__unix__) || defined(__APPLE__)
+#define CS418_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef _CS418_PROGRESSIVE_H
+#define _CS418_PROGRESSIVE_H
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string>
+
+#include "util.h"
+#include "framebuffer.h"
+#include "render.h"
+#include "checkpoint.h"
+
+// Stop conditions and preview output of a progressive render (0 disables a limit)
+struct ProgressiveSettings {
+    int max_passes = NUM_OF_SAMPLES_PER_PIXEL; // sample budget (spp)
+    double time_budget = 0;                    // wall-clock budget in seconds
+    double noise_target = 0;                   // stop once Framebuffer::noise_estimate() is below
+    double write_interval = PREVIEW_WRITE_INTERVAL; // seconds between preview images
+    int write_every_passes = 0;                // also write every N passes
+    int num_threads = 1;
+
+    std::string checkpoint_file;               // empty: no checkpoints
+    double checkpoint_interval = CHECKPOINT_INTERVAL; // seconds between checkpoints
+};
+
+// Renders passes of 1 spp per pixel into a float accumulation buffer and writes
+// the running average every few seconds / passes until a budget is reached
+class ProgressiveRenderer {
+    public:
+        ProgressiveRenderer(const RenderContext& context, const ProgressiveSettings& progressive_settings)
+            : ctx(context), settings(progressive_settings), framebuffer(context.width, context.height) {}
+
+        /**
+            Continue from a checkpointed framebuffer. Every pixel carries on from its own
+            sample count, so the result matches a render that was never interrupted.
+            @return false when the size doesn't match
+        */
+        bool resume(const Framebuffer& saved) {
+            if (saved.width != ctx.width || saved.height != ctx.height)
+                return false;
+            framebuffer = saved;
+            passes = static_cast<int>(*std::min_element(framebuffer.count.begin(), framebuffer.count.end()));
+            return true;
+        }
+
+        // Scene description stored in checkpoints (magic, version and passes are filled in)
+        void set_checkpoint_header(const CheckpointHeader& header) { checkpoint_header = header; }
+
+        /**
+            Render until a budget is met, writing previews and the final image to file_name
+            @return number of complete passes
+        */
+        int render(const std::string& file_name) {
+            auto start = std::chrono::steady_clock::now();
+            double last_write = 0, last_checkpoint = 0;
+            std::atomic<bool> out_of_time(false);
+            CheckpointWriter checkpoint_writer(settings.checkpoint_file);
+
+            while (passes < settings.max_passes || settings.max_passes <= 0) {
+                uint32_t pass = static_cast<uint32_t>(passes);
+                // Pixels with (x, y) % block == 0 are traced first; the first pass is split there
+                // so a coarse image is written after 1 / (block * block) of the work
+                int block = PREVIEW_BLOCK_SIZE;
+                for (int coarse = (passes == 0 ? 1 : 0); coarse >= 0; --coarse) {
+                    parallel_for(ctx.height, settings.num_threads, [&](int y) {
+                        // Rows left over when the time budget runs out stay at the previous pass count
+                        if (out_of_time || (coarse && y % block != 0))
+                            return;
+                        for (int x = 0; x < ctx.width; ++x) {
+                            bool on_grid = x % block == 0 && y % block == 0;
+                            // Pixels already past this pass (resumed from a partial pass) are skipped
+                            if ((passes > 0 || on_grid == (coarse == 1)) && framebuffer.samples(x, y) == pass)
+                                framebuffer.add_sample(x, y, render_sample(ctx, x, y, pass));
+                        }
+                        if (settings.time_budget > 0 && elapsed_seconds(start) > settings.time_budget)
+                            out_of_time = true;
+                    });
+                    if (coarse && !out_of_time) {
+                        framebuffer.write_ppm(file_name);
+                        std::cout << "Coarse preview written after " << elapsed_seconds(start) << "s" << std::endl;
+                    }
+                }
+                if (out_of_time)
+                    break;
+                ++passes;
+
+                double now = elapsed_seconds(start);
+                double noise = framebuffer.noise_estimate();
+                std::cout << "\rPass " << passes << "  " << now << "s  noise " << noise << std::flush;
+
+                bool converged = settings.noise_target > 0 && noise < settings.noise_target;
+                bool write = now - last_write >= settings.write_interval ||
+                             (settings.write_every_passes > 0 && passes % settings.write_every_passes == 0);
+                if (converged || (settings.time_budget > 0 && now >= settings.time_budget))
+                    break;
+                if (write) {
+                    framebuffer.write_ppm(file_name);
+                    last_write = now;
+                }
+                // Snapshot between passes; the file is written while the next pass renders
+                if (checkpoint_writer.enabled() && now - last_checkpoint >= settings.checkpoint_interval) {
+                    if (checkpoint_writer.submit(make_checkpoint_header(), framebuffer))
+                        last_checkpoint = now;
+                }
+            }
+
+            framebuffer.write_ppm(file_name);
+            if (checkpoint_writer.enabled()) {
+                checkpoint_writer.wait();
+                if (!write_checkpoint(settings.checkpoint_file, make_checkpoint_header(), framebuffer))
+                    std::cerr << "Failed to write checkpoint " << settings.checkpoint_file << std::endl;
+            }
+            std::cout << "\nProgressive render: " << passes << " passes, " << framebuffer.total_samples()
+                      << " samples in " << elapsed_seconds(start) << "s, noise " << framebuffer.noise_estimate() << std::endl;
+            return passes;
+        }
+
+        const Framebuffer& get_framebuffer() const { return framebuffer; }
+
+    private:
+        CheckpointHeader make_checkpoint_header() const {
+            CheckpointHeader header = checkpoint_header;
+            memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+            header.version = CHECKPOINT_VERSION;
+            header.width = ctx.width;
+            header.height = ctx.height;
+            header.passes = static_cast<uint32_t>(passes);
+            return header;
+        }
+
+        RenderContext ctx;
+        ProgressiveSettings settings;
+        Framebuffer framebuffer;
+        CheckpointHeader checkpoint_header = CheckpointHeader();
+        int passes = 0;
+};
+
+#endif
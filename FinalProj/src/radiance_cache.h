@@ -0,0 +1,226 @@
+#ifndef _CS418_RADIANCE_CACHE_H
+#define _CS418_RADIANCE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "util.h"
+#include "object.h"
+#include "material.h"
+#include "environment.h"
+#include "helper.h"
+
+// World-space radiance cache: an open-addressing hash table of (grid cell, normal
+// direction) entries, each the running mean of the radiance arriving at lambertian
+// surfaces through their cosine-sampled bounce. Every thread adds the result of its
+// finished bounces and reads the table concurrently without locks: entries are
+// claimed with a compare-exchange on their key and accumulate in fixed point with
+// atomic adds. When the table is full, new cells are dropped (not evicted).
+// Cells can grow with the distance from the camera tracing the path (set_level_of_detail)
+// so the far parts of large scenes, seen by few paths, still gather enough samples per
+// cell. Cells of the same size are shared by all cameras (views, animation frames).
+class RadianceCache {
+    public:
+        /**
+            @param size_t memory_budget in bytes, rounded down to whole entries
+            @param double cell_size edge of a cache cell in world units
+            @param double spread paths end in the cache once the area of their footprint
+                   exceeds this fraction of the primary hit's (smaller: earlier, faster, more bias)
+            @param int min_samples an entry answers lookups from this many samples on
+        */
+        RadianceCache(size_t memory_budget, double cell_size, double spread,
+                      int min_samples = RADIANCE_CACHE_MIN_SAMPLES)
+            : entries(std::max<size_t>(memory_budget / sizeof(Entry), 1)), inv_cell_size(1.0 / cell_size),
+              spread_threshold(spread), min_samples(static_cast<uint32_t>(std::max(min_samples, 1))) {}
+
+        /**
+            Cells are cell_size wide within distance of the camera, and double in size
+            every time the distance doubles beyond it
+            @param double distance usually the distance to the subject, 0: same size everywhere
+        */
+        void set_level_of_detail(double distance) {
+            inv_lod_distance = distance > 0 ? 1.0 / distance : 0.0;
+        }
+
+        RadianceCache(const RadianceCache&) = delete;
+        RadianceCache& operator=(const RadianceCache&) = delete;
+
+        // Add one estimate of the radiance arriving at (point, normal), seen from a camera at eye
+        void add(const Vec3& point, const Vec3& normal, const Vec3& eye, const Vec3& radiance) {
+            Entry* entry = insert(cell_key(point, normal, eye));
+            if (!entry)
+                return;
+            for (int k = 0; k < 3; ++k) {
+                // Clamped so a single bright sample can't overflow the entry or dominate it
+                double value = clamp(radiance[k], 0.0, RADIANCE_CACHE_MAX_RADIANCE);
+                if (value == value)
+                    entry->sum[k].fetch_add(static_cast<uint64_t>(value * FIXED_POINT_SCALE), std::memory_order_relaxed);
+            }
+            entry->count.fetch_add(1, std::memory_order_release);
+        }
+
+        /**
+            Mean radiance arriving at (point, normal), once its cell has min_samples
+            @return false when the cell isn't cached (yet)
+        */
+        bool lookup(const Vec3& point, const Vec3& normal, const Vec3& eye, Vec3& radiance) const {
+            const Entry* entry = find(cell_key(point, normal, eye));
+            if (!entry)
+                return false;
+            // Sums may already hold a few samples more than count: negligible once count is large
+            uint32_t count = entry->count.load(std::memory_order_acquire);
+            if (count < min_samples)
+                return false;
+            double scale = 1.0 / (FIXED_POINT_SCALE * count);
+            radiance = Vec3(entry->sum[0].load(std::memory_order_relaxed) * scale,
+                            entry->sum[1].load(std::memory_order_relaxed) * scale,
+                            entry->sum[2].load(std::memory_order_relaxed) * scale);
+            return true;
+        }
+
+        double get_spread_threshold() const { return spread_threshold; }
+        size_t capacity() const { return entries.size(); }
+
+        // Entries claimed so far (scans the table)
+        size_t num_cells() const {
+            size_t used = 0;
+            for (const Entry& entry : entries)
+                used += entry.key.load(std::memory_order_relaxed) != 0;
+            return used;
+        }
+
+        size_t memory_bytes() const { return entries.size() * sizeof(Entry); }
+
+    private:
+        struct Entry {
+            std::atomic<uint64_t> key{0}; // 0: free
+            std::atomic<uint32_t> count{0};
+            std::atomic<uint64_t> sum[3] = {{0}, {0}, {0}};
+        };
+
+        static constexpr double FIXED_POINT_SCALE = 65536.0;
+
+        // Grid cell of the point at its level of detail, plus the dominant axis and sign
+        // of the normal so opposite sides of a thin object don't share an entry
+        uint64_t cell_key(const Vec3& point, const Vec3& normal, const Vec3& eye) const {
+            int level = 0;
+            double relative_distance = (point - eye).length() * inv_lod_distance;
+            if (relative_distance >= 1.0)
+                level = std::min(ilogb(relative_distance) + 1, RADIANCE_CACHE_MAX_LEVEL);
+            double inv_size = ldexp(inv_cell_size, -level);
+
+            int axis = fabs(normal.x()) > fabs(normal.y()) ? (fabs(normal.x()) > fabs(normal.z()) ? 0 : 2)
+                                                           : (fabs(normal.y()) > fabs(normal.z()) ? 1 : 2);
+            uint64_t key = mix_seed(8 * level + 2 * axis + (normal[axis] < 0));
+            for (int k = 0; k < 3; ++k)
+                key = mix_seed(key ^ static_cast<uint64_t>(static_cast<int64_t>(floor(point[k] * inv_size))));
+            return key | 1;
+        }
+
+        // Entry of key, linear probing over RADIANCE_CACHE_PROBES slots
+        const Entry* find(uint64_t key) const {
+            size_t slot = static_cast<size_t>(key % entries.size());
+            for (int probe = 0; probe < RADIANCE_CACHE_PROBES; ++probe) {
+                uint64_t current = entries[slot].key.load(std::memory_order_acquire);
+                if (current == key)
+                    return &entries[slot];
+                if (current == 0)
+                    return nullptr;
+                if (++slot == entries.size())
+                    slot = 0;
+            }
+            return nullptr;
+        }
+
+        // Same, claiming the first free slot when key isn't present
+        Entry* insert(uint64_t key) {
+            size_t slot = static_cast<size_t>(key % entries.size());
+            for (int probe = 0; probe < RADIANCE_CACHE_PROBES; ++probe) {
+                Entry& entry = entries[slot];
+                uint64_t current = entry.key.load(std::memory_order_acquire);
+                if (current == 0 && entry.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+                    return &entry;
+                // Current holds the winner's key when another thread claimed the slot first
+                if (current == key)
+                    return &entry;
+                if (++slot == entries.size())
+                    slot = 0;
+            }
+            return nullptr;
+        }
+
+        std::vector<Entry> entries;
+        double inv_cell_size;
+        double inv_lod_distance = 0; // 0: same cell size everywhere
+        double spread_threshold;
+        uint32_t min_samples;
+};
+
+/**
+    generate_pixel_color with early termination through a radiance cache: once the
+    footprint of the path has spread over spread_limit (secondary vertices only),
+    a lambertian hit returns its cached incoming radiance instead of bouncing on.
+    Bounces that are traced all the way add their result to the cache.
+
+    @param Ray Given emitted ray
+    @param Object Scene
+    @param int current depth
+    @param Background radiance for rays leaving the scene
+    @param RadianceCache cache read and filled
+    @param Vec3 eye position of the camera, picks the cell sizes
+    @param double spread_limit footprint (square root of an area) above which the path
+           may end in the cache: sqrt(spread threshold * a0), a0 the primary hit's area;
+           negative for the camera ray, derived at its first hit
+    @param double path_spread footprint (square root of an area) accumulated so far
+    @param double pdf of the lambertian bounce that produced r (negative: camera/specular ray)
+*/
+inline Vec3 generate_pixel_color_cached(const Ray& r, const Object& scene, int depth, const Background& background,
+                                        RadianceCache& cache, const Vec3& eye, double spread_limit = -1, double path_spread = 0,
+                                        double bsdf_pdf = -1) {
+    Intersection rec;
+
+    if (depth <= 0)
+        return Vec3(0,0,0);
+
+    if (scene.intersect(r, 0.001, INF_DOUBLE, rec)) {
+        double distance = rec.t * r.direction().length();
+        double cos_in = fmax(fabs(dot(rec.normal, unit_vector(r.direction()))), 1e-4);
+        bool secondary = spread_limit >= 0;
+        if (!secondary) {
+            // Area spread of the primary hit, a0 = d^2 / (4 pi cos), scaled by the quality setting
+            spread_limit = sqrt(cache.get_spread_threshold() * distance * distance / (4 * PI * cos_in));
+        } else if (bsdf_pdf > 0) {
+            path_spread += sqrt(distance * distance / (bsdf_pdf * cos_in));
+        }
+
+        Ray scattered;
+        Vec3 attenuation;
+        if (!rec.mat_ptr->scatter(r, rec, attenuation, scattered))
+            return Vec3(0,0,0);
+
+        if (!rec.mat_ptr->is_lambertian())
+            return attenuation * generate_pixel_color_cached(scattered, scene, depth - 1, background, cache, eye, spread_limit, path_spread);
+
+        Vec3 direct;
+        if (background.can_sample())
+            direct = sample_background_light(rec, attenuation, scene, background);
+
+        Vec3 incoming;
+        if (secondary && path_spread > spread_limit && cache.lookup(rec.point, rec.normal, eye, incoming))
+            return direct + attenuation * incoming;
+
+        double scattered_pdf = fmax(dot(rec.normal, unit_vector(scattered.direction())), 0.0) / PI;
+        incoming = generate_pixel_color_cached(scattered, scene, depth - 1, background, cache, eye, spread_limit, path_spread, scattered_pdf);
+        cache.add(rec.point, rec.normal, eye, incoming);
+        return direct + attenuation * incoming;
+    }
+
+    Vec3 unit_direction = unit_vector(r.direction());
+    Vec3 sky = background.radiance(unit_direction);
+    if (bsdf_pdf >= 0 && background.can_sample())
+        return mis_weight(bsdf_pdf, background.pdf(unit_direction)) * sky;
+    return sky;
+}
+
+#endif
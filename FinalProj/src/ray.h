@@ -7,18 +7,27 @@ class Ray
 {
     public:
         Ray() {}
-        Ray(const Vec3& origin, const Vec3& direction): orig(origin), dir(direction){}
+        Ray(const Vec3& origin, const Vec3& direction, double spread = 0): orig(origin), dir(direction), spread_angle(spread) {}
 
         Vec3 origin() const  { return orig; }
         Vec3 direction() const { return dir; }
 
+        // Angle of the cone around the ray covered by one pixel, 0 when unknown (bounced rays)
+        double spread() const { return spread_angle; }
+
         Vec3 at(double t) const {
             return orig + t * dir;
         }
 
+        // Width of the ray cone at parameter t
+        double footprint(double t) const {
+            return spread_angle * t * dir.length();
+        }
+
     private:
         Vec3 orig;
         Vec3 dir;
+        double spread_angle = 0;
 };
 
 #endif
@@ -0,0 +1,29 @@
+#ifndef _CS418_RAY_TRACER_H
+#define _CS418_RAY_TRACER_H
+
+// Library entry point: include this header (from any number of translation units)
+// to build scenes and render them with Renderer into your own buffers
+#include "config.h"
+#include "util.h"
+#include "object.h"
+#include "scene.h"
+#include "sphere.h"
+#include "plane.h"
+#include "material.h"
+#include "texture.h"
+#include "transform.h"
+#include "instance.h"
+#include "bvh.h"
+#include "wide_bvh.h"
+#include "grid.h"
+#include "accel.h"
+#include "camera.h"
+#include "environment.h"
+#include "helper.h"
+#include "radiance_cache.h"
+#include "renderer.h"
+#include "outofcore.h"
+#include "scene_cache.h"
+#include "temporal.h"
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef _CS418_RENDER_H
+#define _CS418_RENDER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+#include "object.h"
+#include "camera.h"
+#include "environment.h"
+#include "helper.h"
+#include "radiance_cache.h"
+
+// Everything needed to trace one camera sample
+struct RenderContext {
+    const Object* scene;
+    const Camera* camera;
+    const Background* background;
+    int width;
+    int height;
+    int max_depth;
+    uint64_t seed;
+    RadianceCache* radiance_cache; // optional, shared by all threads
+};
+
+/**
+    Trace sample number sample_index of pixel (x, y), y = 0 being the top row.
+    The generator is reseeded from (seed, pixel, sample) first, so the result does not
+    depend on which thread traces it or in which order.
+*/
+inline Vec3 render_sample(const RenderContext& ctx, int x, int y, uint32_t sample_index) {
+    uint64_t pixel = static_cast<uint64_t>(y) * ctx.width + x;
+    seed_random(mix_seed(ctx.seed ^ mix_seed(pixel)) + sample_index);
+
+    int j = ctx.height - 1 - y;
+    auto u = (x + generate_random_double()) / (ctx.width - 1);
+    auto v = (j + generate_random_double()) / (ctx.height - 1);
+    Ray r = ctx.camera->emit_ray(u, v, ctx.camera->pixel_spread(ctx.height));
+    Vec3 c = ctx.radiance_cache ? generate_pixel_color_cached(r, *ctx.scene, ctx.max_depth, *ctx.background, *ctx.radiance_cache,
+                                                              ctx.camera->get_origin())
+                                : generate_pixel_color(r, *ctx.scene, ctx.max_depth, *ctx.background);
+
+    // NaN would poison an accumulation buffer for good
+    for (int k = 0; k < 3; ++k) {
+        if (c[k] != c[k])
+            c[k] = 0.0;
+    }
+    return c;
+}
+
+// Seconds since start
+inline double elapsed_seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline int default_thread_count() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+/**
+    Run fn(i) for i in [0, count) on num_threads threads, items handed out one at a time
+    @param int count
+    @param int num_threads
+*/
+template <typename Fn>
+void parallel_for(int count, int num_threads, Fn fn) {
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++)
+            fn(i);
+    };
+
+    num_threads = std::max(1, std::min(num_threads, count));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+}
+
+#endif
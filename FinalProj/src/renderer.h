@@ -0,0 +1,128 @@
+#ifndef _CS418_RENDERER_H
+#define _CS418_RENDERER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "util.h"
+#include "object.h"
+#include "camera.h"
+#include "environment.h"
+#include "helper.h"
+#include "render.h"
+
+// Image settings of a Renderer
+struct RenderSettings {
+    int width = IMAGE_WIDTH;
+    int height = static_cast<int>(IMAGE_WIDTH / ASPECT_RADIO);
+    int samples_per_pixel = NUM_OF_SAMPLES_PER_PIXEL;
+    int max_depth = RAY_BOUNCE_DEPTH_LIMIT;
+    uint64_t seed = 1;
+    int num_threads = 0; // 0: all cores
+};
+
+// Pixel rectangle of the image, y = 0 is the top row
+struct RenderRegion {
+    int x, y, width, height;
+};
+
+// Embeddable renderer: scene, camera and settings are passed in, pixels are
+// written straight into a caller-owned buffer (no intermediate image).
+// Any thread may call cancel() to stop the render in progress. The cancel stays in
+// effect for later calls (e.g. the next band) until reset_cancel().
+class Renderer {
+    public:
+        Renderer(shared_ptr<Object> render_scene, const Camera& render_camera, const RenderSettings& render_settings,
+                 shared_ptr<Background> render_background = nullptr)
+            : scene(render_scene), camera(render_camera), settings(render_settings),
+              background(render_background ? render_background : make_shared<SkyGradient>()) {
+            if (settings.num_threads <= 0)
+                settings.num_threads = default_thread_count();
+        }
+
+        void set_camera(const Camera& render_camera) { camera = render_camera; }
+        // Optional radiance cache: faster, slightly biased (see radiance_cache.h)
+        void set_radiance_cache(shared_ptr<RadianceCache> cache) { radiance_cache = cache; }
+        void set_settings(const RenderSettings& render_settings) { settings = render_settings; }
+        const RenderSettings& get_settings() const { return settings; }
+
+        RenderRegion full_image() const { return {0, 0, settings.width, settings.height}; }
+
+        /**
+            Render linear RGB (average radiance, 3 floats per pixel) into rgb
+            @param float* buffer holding region.height rows
+            @param size_t row_stride in bytes between rows (0: region.width * 3 floats)
+            @param RenderRegion region of the image to render
+            @return false when cancelled or the region is outside the image
+        */
+        bool render(float* rgb, size_t row_stride, const RenderRegion& region) {
+            if (row_stride == 0)
+                row_stride = region.width * 3 * sizeof(float);
+            return render_region(region, [&](int x, int y, const Vec3& sum) {
+                float* pixel = reinterpret_cast<float*>(reinterpret_cast<char*>(rgb) + (y - region.y) * row_stride) + 3 * (x - region.x);
+                for (int k = 0; k < 3; ++k)
+                    pixel[k] = static_cast<float>(sum[k] / settings.samples_per_pixel);
+            });
+        }
+
+        /**
+            Render gamma-corrected RGBA8 (alpha 255, same values as the ppm output) into rgba
+            @param uint8_t* buffer holding region.height rows
+            @param size_t row_stride in bytes between rows (0: region.width * 4)
+            @param RenderRegion region of the image to render
+            @return false when cancelled or the region is outside the image
+        */
+        bool render_rgba8(uint8_t* rgba, size_t row_stride, const RenderRegion& region) {
+            if (row_stride == 0)
+                row_stride = region.width * 4;
+            return render_region(region, [&](int x, int y, const Vec3& sum) {
+                uint8_t* pixel = rgba + (y - region.y) * row_stride + 4 * (x - region.x);
+                pixel_to_rgb8(sum, settings.samples_per_pixel, pixel);
+                pixel[3] = 255;
+            });
+        }
+
+        void cancel() { cancelled = true; }
+        void reset_cancel() { cancelled = false; }
+        bool is_cancelled() const { return cancelled; }
+
+    private:
+        template <typename Store>
+        bool render_region(const RenderRegion& region, Store store) {
+            if (region.x < 0 || region.y < 0 || region.width <= 0 || region.height <= 0 ||
+                region.x + region.width > settings.width || region.y + region.height > settings.height)
+                return false;
+
+            RenderContext ctx = {scene.get(), &camera, background.get(), settings.width, settings.height,
+                                 settings.max_depth, settings.seed, radiance_cache.get()};
+            // Tiles rather than rows, so even a few rows keep every core busy
+            int tiles_x = (region.width + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+            int tiles_y = (region.height + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+            parallel_for(tiles_x * tiles_y, settings.num_threads, [&](int tile) {
+                if (cancelled)
+                    return;
+                int x0 = region.x + (tile % tiles_x) * RENDER_TILE_SIZE, y0 = region.y + (tile / tiles_x) * RENDER_TILE_SIZE;
+                int x1 = std::min(x0 + RENDER_TILE_SIZE, region.x + region.width);
+                int y1 = std::min(y0 + RENDER_TILE_SIZE, region.y + region.height);
+                for (int y = y0; y < y1; ++y) {
+                    for (int x = x0; x < x1; ++x) {
+                        Vec3 sum;
+                        for (int s = 0; s < settings.samples_per_pixel; ++s)
+                            sum += render_sample(ctx, x, y, s);
+                        store(x, y, sum);
+                    }
+                }
+            });
+            return !cancelled;
+        }
+
+        shared_ptr<Object> scene;
+        Camera camera;
+        RenderSettings settings;
+        shared_ptr<Background> background;
+        shared_ptr<RadianceCache> radiance_cache;
+        std::atomic<bool> cancelled{false};
+};
+
+#endif
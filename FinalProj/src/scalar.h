@@ -0,0 +1,64 @@
+#ifndef _CS418_SCALAR_H
+#define _CS418_SCALAR_H
+
+// Scalar helpers and the random number generator. They don't depend on Vec3, so
+// vec3.h includes this header directly; util.h includes it for everything else.
+#include <cstdint>
+#include <cmath>
+
+#include "config.h"
+
+inline double deg_to_rad(double degrees) {
+    return degrees * PI / 180.0;
+}
+
+inline double clamp(double x, double min, double max) {
+    if (x < min) return min;
+    if (x > max) return max;
+    return x;
+}
+// splitmix64 step, used to derive well-mixed seeds from (seed, pixel, sample) tuples
+inline uint64_t mix_seed(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Per-thread generator state (xorshift64*), so worker threads never share a generator
+inline uint64_t& random_state() {
+    thread_local uint64_t state = 0x853C49E6748FEA9Bull;
+    return state;
+}
+
+inline void seed_random(uint64_t seed) {
+    uint64_t s = mix_seed(seed);
+    random_state() = s ? s : 1;
+}
+
+// Returns a random double in [0,1).
+inline double generate_random_double() {
+    uint64_t& x = random_state();
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return ((x * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Returns a random double in [min,max).
+inline double generate_random_double(double min, double max) {
+    return min + (max-min) * generate_random_double();
+}
+
+// Returns a random int in [min,max).
+inline int generate_random_int(int min, int max) {
+    return min + static_cast<int>(generate_random_double() * (max - min));
+}
+
+inline double schlick(double cosine, double ref_idx) {
+    auto r0 = (1 - ref_idx) / (1 + ref_idx);
+    r0 = pow(r0, 2);
+    return r0 + (1 - r0) * pow((1 - cosine), 5);
+}
+
+#endif
@@ -0,0 +1,503 @@
+#ifndef _CS418_SCENE_CACHE_H
+#define _CS418_SCENE_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "platform.h"
+#include "util.h"
+#include "object.h"
+#include "sphere.h"
+#include "plane.h"
+#include "material.h"
+#include "texture.h"
+
+// Binary scene cache: flattened primitives, material / texture tables and a
+// prebuilt BVH, all referencing each other by index so the file can be mapped
+// at any address and traced in place. Native byte order; sections start on
+// SCENE_CACHE_ALIGNMENT byte boundaries in this order:
+//   header | spheres (BVH leaf order) | nodes | planes | materials | textures
+struct SceneCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;    // SCENE_CACHE_BYTE_ORDER as written by the producer
+    uint64_t file_size;
+    uint64_t seed;          // generator settings the scene was made with
+    int32_t num_of_sphere;
+    uint32_t num_spheres;
+    uint32_t num_nodes;
+    uint32_t num_planes;
+    uint32_t num_materials;
+    uint32_t num_textures;
+    uint64_t sphere_offset;
+    uint64_t node_offset;
+    uint64_t plane_offset;
+    uint64_t material_offset;
+    uint64_t texture_offset;
+};
+
+struct CachedSphere {
+    double center[3];
+    double radius;
+    uint32_t material;
+    uint32_t reserved;
+};
+
+// Depth-first BVH node: an inner node's left child follows it, offset is its right child;
+// a leaf (count > 0) holds spheres [offset, offset + count)
+struct CachedNode {
+    float lo[3];
+    float hi[3];
+    uint32_t offset;
+    uint16_t count;
+    uint16_t axis;
+};
+
+struct CachedPlane {
+    double point[3];
+    double normal[3];
+    uint32_t material;
+    uint32_t reserved;
+};
+
+const char SCENE_CACHE_MAGIC[8] = {'C', 'S', '4', '1', '8', 'S', 'C', 'N'};
+const uint32_t SCENE_CACHE_VERSION = 1;
+const uint32_t SCENE_CACHE_BYTE_ORDER = 0x01020304;
+const uint64_t SCENE_CACHE_ALIGNMENT = 64;
+
+// float bounds that still contain the double value
+inline float float_below(double v) {
+    float f = static_cast<float>(v);
+    return f > v ? nextafterf(f, -INFINITY) : f;
+}
+
+inline float float_above(double v) {
+    float f = static_cast<float>(v);
+    return f < v ? nextafterf(f, INFINITY) : f;
+}
+
+/**
+    Build the flattened BVH over spheres[start, end): median split on the longest
+    centroid axis, reordering the spheres so every leaf is a contiguous range
+    @param vector nodes the depth-first node array
+*/
+inline void build_cache_nodes(std::vector<CachedSphere>& spheres, size_t start, size_t end, std::vector<CachedNode>& nodes) {
+    size_t index = nodes.size();
+    nodes.push_back(CachedNode());
+
+    double lo[3] = {INF_DOUBLE, INF_DOUBLE, INF_DOUBLE}, hi[3] = {-INF_DOUBLE, -INF_DOUBLE, -INF_DOUBLE};
+    double c_lo[3] = {INF_DOUBLE, INF_DOUBLE, INF_DOUBLE}, c_hi[3] = {-INF_DOUBLE, -INF_DOUBLE, -INF_DOUBLE};
+    for (size_t i = start; i < end; ++i) {
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = fmin(lo[a], spheres[i].center[a] - spheres[i].radius);
+            hi[a] = fmax(hi[a], spheres[i].center[a] + spheres[i].radius);
+            c_lo[a] = fmin(c_lo[a], spheres[i].center[a]);
+            c_hi[a] = fmax(c_hi[a], spheres[i].center[a]);
+        }
+    }
+    CachedNode node = CachedNode();
+    for (int a = 0; a < 3; ++a) {
+        node.lo[a] = float_below(lo[a]);
+        node.hi[a] = float_above(hi[a]);
+    }
+
+    if (end - start <= static_cast<size_t>(SCENE_CACHE_LEAF_SIZE)) {
+        node.offset = static_cast<uint32_t>(start);
+        node.count = static_cast<uint16_t>(end - start);
+        nodes[index] = node;
+        return;
+    }
+
+    int axis = 0;
+    for (int a = 1; a < 3; ++a)
+        if (c_hi[a] - c_lo[a] > c_hi[axis] - c_lo[axis])
+            axis = a;
+    size_t mid = start + (end - start) / 2;
+    std::nth_element(spheres.begin() + start, spheres.begin() + mid, spheres.begin() + end,
+        [axis](const CachedSphere& a, const CachedSphere& b) { return a.center[axis] < b.center[axis]; });
+
+    build_cache_nodes(spheres, start, mid, nodes);
+    node.offset = static_cast<uint32_t>(nodes.size());
+    node.axis = static_cast<uint16_t>(axis);
+    build_cache_nodes(spheres, mid, end, nodes);
+    nodes[index] = node;
+}
+
+/**
+    Levels of a depth-first cache BVH, checking its layout on the way: an inner node's left
+    child follows it, its right child follows the left subtree, leaves are within num_spheres.
+    Linear in num_nodes whatever the offsets hold.
+    @return 0 when the nodes don't form such a tree
+*/
+inline int cache_tree_depth(const CachedNode* nodes, uint32_t num_nodes, uint32_t num_spheres) {
+    if (num_nodes == 0)
+        return 0;
+    std::vector<std::pair<uint32_t, int>> pending; // right children still to visit, and their level
+    uint32_t index = 0;
+    int level = 1, depth = 0;
+    while (true) {
+        const CachedNode& node = nodes[index];
+        depth = std::max(depth, level);
+        if (node.count == 0) {
+            if (node.offset <= index + 1 || node.offset >= num_nodes)
+                return 0;
+            pending.push_back(std::make_pair(node.offset, level + 1));
+            ++index;
+            ++level;
+            continue;
+        }
+        if (static_cast<uint64_t>(node.offset) + node.count > num_spheres)
+            return 0;
+        if (pending.empty())
+            return index + 1 == num_nodes ? depth : 0;
+        if (pending.back().first != index + 1)
+            return 0;
+        index = pending.back().first;
+        level = pending.back().second;
+        pending.pop_back();
+    }
+}
+
+/**
+    Write a scene cache (through a temp file, renamed when complete)
+    @param char* path
+    @param vector objects: spheres and planes with describable materials
+    @param int num_of_sphere / uint64_t seed the scene was generated with
+    @return false (with a message) for other objects / materials or on I/O error
+*/
+inline bool write_scene_cache(const char* path, const std::vector<shared_ptr<Object>>& objects, int num_of_sphere, uint64_t seed) {
+    std::vector<CachedSphere> spheres;
+    std::vector<CachedPlane> planes;
+    std::vector<MaterialRecord> materials;
+    std::vector<TextureRecord> textures;
+    std::unordered_map<const Material*, uint32_t> material_index;
+
+    auto add_material = [&](const shared_ptr<Material>& material, uint32_t& index) {
+        auto found = material_index.find(material.get());
+        if (found != material_index.end()) {
+            index = found->second;
+            return true;
+        }
+        MaterialRecord record;
+        if (!material || !material->describe(textures, record))
+            return false;
+        index = material_index[material.get()] = static_cast<uint32_t>(materials.size());
+        materials.push_back(record);
+        return true;
+    };
+
+    for (const auto& object : objects) {
+        bool ok = false;
+        if (const Sphere* sphere = dynamic_cast<const Sphere*>(object.get())) {
+            CachedSphere record = CachedSphere();
+            for (int a = 0; a < 3; ++a)
+                record.center[a] = sphere->center[a];
+            record.radius = sphere->radius;
+            ok = add_material(sphere->mat_ptr, record.material);
+            spheres.push_back(record);
+        } else if (const Plane* plane = dynamic_cast<const Plane*>(object.get())) {
+            CachedPlane record = CachedPlane();
+            for (int a = 0; a < 3; ++a) {
+                record.point[a] = plane->point[a];
+                record.normal[a] = plane->normal[a];
+            }
+            ok = add_material(plane->mat_ptr, record.material);
+            planes.push_back(record);
+        }
+        if (!ok) {
+            std::cerr << "Scene cache only stores spheres and planes with solid / checker textures" << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<CachedNode> nodes;
+    if (!spheres.empty())
+        build_cache_nodes(spheres, 0, spheres.size(), nodes);
+    // Median splits: about log2(spheres / SCENE_CACHE_LEAF_SIZE) + 1 levels, one stack entry each
+    assert(cache_tree_depth(nodes.data(), static_cast<uint32_t>(nodes.size()), static_cast<uint32_t>(spheres.size()))
+           <= SCENE_CACHE_STACK_SIZE && "Scene cache BVH deeper than its traversal stack");
+
+    SceneCacheHeader header = SceneCacheHeader();
+    memcpy(header.magic, SCENE_CACHE_MAGIC, sizeof(SCENE_CACHE_MAGIC));
+    header.version = SCENE_CACHE_VERSION;
+    header.byte_order = SCENE_CACHE_BYTE_ORDER;
+    header.seed = seed;
+    header.num_of_sphere = num_of_sphere;
+    header.num_spheres = static_cast<uint32_t>(spheres.size());
+    header.num_nodes = static_cast<uint32_t>(nodes.size());
+    header.num_planes = static_cast<uint32_t>(planes.size());
+    header.num_materials = static_cast<uint32_t>(materials.size());
+    header.num_textures = static_cast<uint32_t>(textures.size());
+
+    auto align = [](uint64_t offset) { return (offset + SCENE_CACHE_ALIGNMENT - 1) / SCENE_CACHE_ALIGNMENT * SCENE_CACHE_ALIGNMENT; };
+    header.sphere_offset = align(sizeof(header));
+    header.node_offset = align(header.sphere_offset + spheres.size() * sizeof(CachedSphere));
+    header.plane_offset = align(header.node_offset + nodes.size() * sizeof(CachedNode));
+    header.material_offset = align(header.plane_offset + planes.size() * sizeof(CachedPlane));
+    header.texture_offset = align(header.material_offset + materials.size() * sizeof(MaterialRecord));
+    header.file_size = header.texture_offset + textures.size() * sizeof(TextureRecord);
+
+    std::string temp_name = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_name.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Can't create " << temp_name << std::endl;
+        return false;
+    }
+
+    auto write_section = [&](uint64_t offset, const void* data, size_t bytes) {
+        static const char padding[SCENE_CACHE_ALIGNMENT] = {};
+        long position = ftell(file);
+        return position >= 0 && fwrite(padding, 1, offset - position, file) == offset - position &&
+               (bytes == 0 || fwrite(data, 1, bytes, file) == bytes);
+    };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              write_section(header.sphere_offset, spheres.data(), spheres.size() * sizeof(CachedSphere)) &&
+              write_section(header.node_offset, nodes.data(), nodes.size() * sizeof(CachedNode)) &&
+              write_section(header.plane_offset, planes.data(), planes.size() * sizeof(CachedPlane)) &&
+              write_section(header.material_offset, materials.data(), materials.size() * sizeof(MaterialRecord)) &&
+              write_section(header.texture_offset, textures.data(), textures.size() * sizeof(TextureRecord));
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp_name.c_str(), path) != 0) {
+        std::cerr << "Failed to write scene cache " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// A scene cache traced in place: the file is mapped read-only (pages are faulted
+// in as rays reach them and shared between processes through the page cache).
+// Materials are created on first hit, so startup doesn't depend on scene size.
+class MappedScene : public Object {
+    public:
+        ~MappedScene() {
+            for (uint32_t i = 0; material_cache && i < header.num_materials; ++i)
+                delete material_cache[i].load();
+#ifdef CS418_HAS_MMAP
+            if (mapping)
+                munmap(mapping, mapping_size);
+#endif
+        }
+
+        MappedScene(const MappedScene&) = delete;
+        MappedScene& operator=(const MappedScene&) = delete;
+
+        /**
+            Map a scene cache written by write_scene_cache
+            @param char* path
+            @return nullptr (with a message) when the file is missing, of another version or corrupt
+        */
+        static shared_ptr<MappedScene> open(const char* path) {
+            shared_ptr<MappedScene> scene(new MappedScene());
+            if (!scene->map_file(path)) {
+                std::cerr << "Can't map scene cache " << path << std::endl;
+                return nullptr;
+            }
+            if (!scene->validate()) {
+                std::cerr << path << " is not a valid scene cache (version " << SCENE_CACHE_VERSION << ")" << std::endl;
+                return nullptr;
+            }
+            scene->setup();
+            return scene;
+        }
+
+        const SceneCacheHeader& get_header() const { return header; }
+
+        bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            bool hit = false;
+            for (const auto& plane : planes) {
+                if (plane.intersect(r, t_min, t_max, int_pt)) {
+                    hit = true;
+                    t_max = int_pt.t;
+                }
+            }
+            if (header.num_nodes == 0)
+                return hit;
+
+            Vec3 o = r.origin(), d = r.direction();
+            double inv_dir[3] = {1.0 / d[0], 1.0 / d[1], 1.0 / d[2]};
+
+            // Nearer child first, the other on the stack
+            uint32_t stack[SCENE_CACHE_STACK_SIZE];
+            int stack_size = 0;
+            stack[stack_size++] = 0;
+            int64_t best = -1;
+            while (stack_size > 0) {
+                uint32_t index = stack[--stack_size];
+                const CachedNode& node = nodes[index];
+
+                double t0 = t_min, t1 = t_max;
+                for (int a = 0; a < 3 && t0 <= t1; ++a) {
+                    double ta = (node.lo[a] - o[a]) * inv_dir[a], tb = (node.hi[a] - o[a]) * inv_dir[a];
+                    if (inv_dir[a] < 0) std::swap(ta, tb);
+                    t0 = ta > t0 ? ta : t0;
+                    t1 = tb < t1 ? tb : t1;
+                }
+                if (t0 > t1)
+                    continue;
+
+                if (node.count > 0) {
+                    uint32_t end = node.offset + node.count;
+                    for (uint32_t i = node.offset; i < end; ++i) {
+                        const CachedSphere& s = spheres[i];
+                        double t;
+                        if (Sphere::hit_sphere(Vec3(s.center[0], s.center[1], s.center[2]), s.radius, r, t_min, t_max, t)) {
+                            t_max = t;
+                            best = static_cast<int64_t>(i);
+                        }
+                    }
+                } else {
+                    // validate() checked the layout and that the depth fits the stack
+                    bool right_first = d[node.axis % 3] < 0;
+                    stack[stack_size++] = right_first ? index + 1 : node.offset;
+                    stack[stack_size++] = right_first ? node.offset : index + 1;
+                }
+            }
+            if (best < 0)
+                return hit;
+
+            // Same hit record as Sphere::intersect
+            const CachedSphere& s = spheres[best];
+            Vec3 center(s.center[0], s.center[1], s.center[2]);
+            int_pt.t = t_max;
+            int_pt.point = r.at(int_pt.t);
+            Vec3 outward_normal = (int_pt.point - center) / s.radius;
+            int_pt.set_face_normal(r, outward_normal);
+            Sphere::get_sphere_uv(outward_normal, int_pt.u, int_pt.v);
+            int_pt.uv_footprint = r.footprint(int_pt.t) / (PI * s.radius);
+            int_pt.mat_ptr = material(s.material);
+            return true;
+        }
+
+        bool get_bbox(BoundingBox& output_box) const {
+            if (!planes.empty() || header.num_nodes == 0)
+                return false;
+            output_box = BoundingBox(Vec3(nodes[0].lo[0], nodes[0].lo[1], nodes[0].lo[2]),
+                                     Vec3(nodes[0].hi[0], nodes[0].hi[1], nodes[0].hi[2]));
+            return true;
+        }
+
+    private:
+        MappedScene() {}
+
+        bool map_file(const char* path) {
+#ifdef CS418_HAS_MMAP
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(SceneCacheHeader))) {
+                ::close(fd);
+                return false;
+            }
+            mapping_size = static_cast<size_t>(info.st_size);
+            void* data = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED)
+                return false;
+            mapping = data;
+            base = static_cast<const char*>(data);
+#else
+            // No mmap: read the whole file (8-byte aligned storage)
+            FILE* file = fopen(path, "rb");
+            if (!file)
+                return false;
+            fseek(file, 0, SEEK_END);
+            long size = ftell(file);
+            fseek(file, 0, SEEK_SET);
+            if (size < static_cast<long>(sizeof(SceneCacheHeader))) {
+                fclose(file);
+                return false;
+            }
+            mapping_size = static_cast<size_t>(size);
+            storage.resize((mapping_size + 7) / 8);
+            bool ok = fread(storage.data(), 1, mapping_size, file) == mapping_size;
+            fclose(file);
+            if (!ok)
+                return false;
+            base = reinterpret_cast<const char*>(storage.data());
+#endif
+            memcpy(&header, base, sizeof(header));
+            return true;
+        }
+
+        // Header, section bounds and the BVH layout (one pass over the nodes, which traversal
+        // then trusts); the sphere and material arrays are not read here
+        bool validate() const {
+            auto section_ok = [this](uint64_t offset, uint64_t count, uint64_t size) {
+                return offset % 8 == 0 && offset >= sizeof(SceneCacheHeader) && offset <= mapping_size &&
+                       count <= (mapping_size - offset) / size;
+            };
+            bool sections_ok = memcmp(header.magic, SCENE_CACHE_MAGIC, sizeof(SCENE_CACHE_MAGIC)) == 0 &&
+                               header.version == SCENE_CACHE_VERSION && header.byte_order == SCENE_CACHE_BYTE_ORDER &&
+                               header.file_size == mapping_size &&
+                               section_ok(header.sphere_offset, header.num_spheres, sizeof(CachedSphere)) &&
+                               section_ok(header.node_offset, header.num_nodes, sizeof(CachedNode)) &&
+                               section_ok(header.plane_offset, header.num_planes, sizeof(CachedPlane)) &&
+                               section_ok(header.material_offset, header.num_materials, sizeof(MaterialRecord)) &&
+                               section_ok(header.texture_offset, header.num_textures, sizeof(TextureRecord)) &&
+                               (header.num_nodes > 0) == (header.num_spheres > 0);
+            if (!sections_ok || header.num_nodes == 0)
+                return sections_ok;
+            // intersect holds at most one stack entry per level
+            int depth = cache_tree_depth(reinterpret_cast<const CachedNode*>(base + header.node_offset),
+                                         header.num_nodes, header.num_spheres);
+            return depth > 0 && depth <= SCENE_CACHE_STACK_SIZE;
+        }
+
+        void setup() {
+            spheres = reinterpret_cast<const CachedSphere*>(base + header.sphere_offset);
+            nodes = reinterpret_cast<const CachedNode*>(base + header.node_offset);
+            materials = reinterpret_cast<const MaterialRecord*>(base + header.material_offset);
+            textures = reinterpret_cast<const TextureRecord*>(base + header.texture_offset);
+            material_cache.reset(new std::atomic<shared_ptr<Material>*>[header.num_materials]());
+            fallback_material = make_shared<DiffuseMaterial>(make_shared<Solid>(0.5, 0.5, 0.5));
+
+            const CachedPlane* plane_records = reinterpret_cast<const CachedPlane*>(base + header.plane_offset);
+            for (uint32_t i = 0; i < header.num_planes; ++i) {
+                const CachedPlane& p = plane_records[i];
+                planes.push_back(Plane(Vec3(p.point[0], p.point[1], p.point[2]), Vec3(p.normal[0], p.normal[1], p.normal[2]),
+                                       material(p.material)));
+            }
+        }
+
+        // Non-owning pointer: materials live as long as the scene (no refcount traffic per hit)
+        shared_ptr<Material> material(uint32_t index) const {
+            if (index >= header.num_materials)
+                return fallback_material;
+
+            shared_ptr<Material>* cached = material_cache[index].load(std::memory_order_acquire);
+            if (!cached) {
+                auto created = make_material(materials[index], textures, header.num_textures);
+                shared_ptr<Material>* fresh = new shared_ptr<Material>(created ? created : fallback_material);
+                if (material_cache[index].compare_exchange_strong(cached, fresh, std::memory_order_acq_rel)) {
+                    cached = fresh;
+                } else {
+                    delete fresh; // another thread created it first
+                }
+            }
+            return shared_ptr<Material>(shared_ptr<Material>(), cached->get());
+        }
+
+        SceneCacheHeader header = SceneCacheHeader();
+        const char* base = nullptr;
+        size_t mapping_size = 0;
+        void* mapping = nullptr;
+        std::vector<uint64_t> storage;
+        const CachedSphere* spheres = nullptr;
+        const CachedNode* nodes = nullptr;
+        const MaterialRecord* materials = nullptr;
+        const TextureRecord* textures = nullptr;
+        std::vector<Plane> planes;
+        std::unique_ptr<std::atomic<shared_ptr<Material>*>[]> material_cache;
+        shared_ptr<Material> fallback_material;
+};
+
+#endif
@@ -12,6 +12,22 @@ class Sphere: public Object  {
 
         // Check if intersect with a sphere 
         bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            double solution;
+            if (!hit_sphere(center, radius, r, t_min, t_max, solution))
+                return false;
+
+            int_pt.t = solution;
+            int_pt.point = r.at(int_pt.t);
+            Vec3 outward_normal = (int_pt.point - center) / radius;
+            int_pt.set_face_normal(r, outward_normal);
+            get_sphere_uv(outward_normal, int_pt.u, int_pt.v);
+            int_pt.uv_footprint = r.footprint(int_pt.t) / (PI * radius); // v spans half a circumference
+            int_pt.mat_ptr = mat_ptr;
+            return true;
+        }
+
+        // Nearest root of the ray/sphere equation within (t_min, t_max)
+        static bool hit_sphere(const Vec3& center, double radius, const Ray& r, double t_min, double t_max, double& t) {
             Vec3 oc = r.origin() - center;
             auto a = r.direction().square_len();
             
@@ -30,11 +46,7 @@ class Sphere: public Object  {
                 }
 
                 if(solution < t_max && solution > t_min) {
-                    int_pt.t = solution;
-                    int_pt.point = r.at(int_pt.t);
-                    Vec3 outward_normal = (int_pt.point - center) / radius;
-                    int_pt.set_face_normal(r, outward_normal);
-                    int_pt.mat_ptr = mat_ptr;
+                    t = solution;
                     return true;
                 }
             }
@@ -46,6 +58,14 @@ class Sphere: public Object  {
             return true;
         }
 
+        // Spherical coordinates of a point on the unit sphere mapped to [0,1]
+        static void get_sphere_uv(const Vec3& p, double& u, double& v) {
+            auto theta = acos(-p.y());
+            auto phi = atan2(-p.z(), p.x()) + PI;
+            u = phi / (2 * PI);
+            v = theta / PI;
+        }
+
     public:
         Vec3 center;
         double radius;
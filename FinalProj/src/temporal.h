@@ -0,0 +1,226 @@
+#ifndef _CS418_TEMPORAL_H
+#define _CS418_TEMPORAL_H
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+#include "object.h"
+#include "camera.h"
+#include "framebuffer.h"
+#include "render.h"
+
+// First hit through every pixel center of a frame, used to validate reprojected history
+struct GBuffer {
+    std::vector<float> depth;       // distance from the camera, INF_DOUBLE for background
+    std::vector<float> normal;      // 3 floats per pixel
+    std::vector<uint32_t> material; // material id, 0 for background
+};
+
+// Sample budget and history validation of an animation render
+struct TemporalSettings {
+    int samples_per_pixel = NUM_OF_SAMPLES_PER_PIXEL; // target samples per pixel
+    int min_samples = TEMPORAL_MIN_SAMPLES;      // new samples per frame in pixels with full history
+    int max_history = NUM_OF_SAMPLES_PER_PIXEL;  // samples carried over at most (bounds lag)
+    double specular_history = TEMPORAL_SPECULAR_HISTORY; // fraction of max_history kept on metal / glass
+    double depth_tolerance = TEMPORAL_DEPTH_TOLERANCE;   // relative
+    double normal_tolerance = TEMPORAL_NORMAL_TOLERANCE; // min cosine
+    bool reuse = true;
+    int num_threads = 1;
+};
+
+struct FrameStats {
+    double seconds;
+    double reused_fraction;  // pixels that kept history
+    uint64_t samples;        // path samples traced (G-buffer rays not included)
+};
+
+// Renders consecutive frames of a camera path: each frame reprojects the previous
+// frame's accumulated radiance through the first hit of every pixel, keeps it where
+// depth, normal and material agree, and spends new samples mostly on the rest
+// (disocclusions, view-dependent metal / glass, pixels with little history)
+class TemporalRenderer {
+    public:
+        TemporalRenderer(const RenderContext& base_context, const TemporalSettings& temporal_settings)
+            : base(base_context), settings(temporal_settings) {}
+
+        FrameStats render_frame(const Camera& camera, const std::string& file_name) {
+            auto start = std::chrono::steady_clock::now();
+            int width = base.width, height = base.height;
+            size_t pixels = static_cast<size_t>(width) * height;
+
+            Framebuffer framebuffer(width, height);
+            GBuffer gbuffer;
+            gbuffer.depth.resize(pixels);
+            gbuffer.normal.resize(3 * pixels);
+            gbuffer.material.resize(pixels);
+
+            RenderContext ctx = base;
+            ctx.camera = &camera;
+            ctx.seed = mix_seed(base.seed + frame);
+            bool has_history = settings.reuse && frame > 0;
+
+            std::atomic<uint64_t> reused(0), samples(0);
+            parallel_for(height, settings.num_threads, [&](int y) {
+                uint64_t row_reused = 0, row_samples = 0;
+                for (int x = 0; x < width; ++x) {
+                    size_t p = static_cast<size_t>(y) * width + x;
+                    Intersection rec;
+                    bool hit = trace_gbuffer(camera, x, y, rec, gbuffer, p);
+
+                    // View-dependent (metal / glass) shading keeps less: its history is low confidence
+                    uint32_t history = 0;
+                    if (has_history && hit) {
+                        double cap = rec.mat_ptr->is_lambertian() ? settings.max_history : settings.specular_history * settings.max_history;
+                        history = reproject(rec, gbuffer, p, static_cast<uint32_t>(cap), framebuffer);
+                    }
+                    row_reused += history > 0;
+
+                    int new_samples = history == 0 ? settings.samples_per_pixel
+                                                   : std::max(settings.min_samples, settings.samples_per_pixel - static_cast<int>(history));
+                    for (int s = 0; s < new_samples; ++s)
+                        framebuffer.add_sample(x, y, render_sample(ctx, x, y, s));
+                    row_samples += new_samples;
+                }
+                reused += row_reused;
+                samples += row_samples;
+            });
+
+            if (!framebuffer.write_ppm(file_name))
+                std::cerr << "Failed to write " << file_name << std::endl;
+
+            previous = framebuffer;
+            previous_gbuffer = std::move(gbuffer);
+            previous_camera = camera;
+            ++frame;
+            return FrameStats{elapsed_seconds(start), static_cast<double>(reused) / pixels, samples};
+        }
+
+    private:
+        // Primary hit through the pixel center, stored in the G-buffer
+        bool trace_gbuffer(const Camera& camera, int x, int y, Intersection& rec, GBuffer& gbuffer, size_t p) const {
+            int j = base.height - 1 - y;
+            Ray ray = camera.center_ray((x + 0.5) / (base.width - 1), (j + 0.5) / (base.height - 1));
+            bool hit = base.scene->intersect(ray, 0.001, INF_DOUBLE, rec);
+            gbuffer.depth[p] = hit ? static_cast<float>(rec.t * ray.direction().length()) : static_cast<float>(INF_DOUBLE);
+            for (int k = 0; k < 3; ++k)
+                gbuffer.normal[3 * p + k] = hit ? static_cast<float>(rec.normal[k]) : 0.0f;
+            gbuffer.material[p] = hit ? material_id(rec.mat_ptr.get()) : 0;
+            return hit;
+        }
+
+        /**
+            Carry the previous frame's samples of the surface point seen by pixel p over
+            @param uint32_t max_history samples kept at most
+            @return number of samples kept (0 when rejected)
+        */
+        uint32_t reproject(const Intersection& rec, const GBuffer& gbuffer, size_t p, uint32_t max_history, Framebuffer& framebuffer) const {
+            double s, t;
+            if (!previous_camera.project(rec.point, s, t))
+                return 0;
+            int px = static_cast<int>(floor(s * (base.width - 1)));
+            int pj = static_cast<int>(floor(t * (base.height - 1)));
+            if (px < 0 || px >= base.width || pj < 0 || pj >= base.height)
+                return 0;
+            size_t q = static_cast<size_t>(base.height - 1 - pj) * base.width + px;
+
+            // Same surface: material, distance from the previous camera and orientation agree
+            double expected = (rec.point - previous_camera.get_origin()).length();
+            double cos_normal = 0;
+            for (int k = 0; k < 3; ++k)
+                cos_normal += previous_gbuffer.normal[3 * q + k] * gbuffer.normal[3 * p + k];
+            if (previous_gbuffer.material[q] != gbuffer.material[p] ||
+                fabs(previous_gbuffer.depth[q] - expected) > settings.depth_tolerance * expected ||
+                cos_normal < settings.normal_tolerance)
+                return 0;
+
+            uint32_t old_count = previous.count[q];
+            uint32_t kept = std::min<uint32_t>(old_count, max_history);
+            if (kept == 0)
+                return 0;
+            float scale = static_cast<float>(kept) / old_count;
+            for (int k = 0; k < 3; ++k)
+                framebuffer.sum[3 * p + k] = previous.sum[3 * q + k] * scale;
+            framebuffer.sum_sq[p] = previous.sum_sq[q] * scale;
+            framebuffer.count[p] = kept;
+            return kept;
+        }
+
+        static uint32_t material_id(const Material* material) {
+            return static_cast<uint32_t>(mix_seed(reinterpret_cast<uintptr_t>(material))) | 1;
+        }
+
+        RenderContext base;
+        TemporalSettings settings;
+        int frame = 0;
+        Framebuffer previous;
+        GBuffer previous_gbuffer;
+        Camera previous_camera;
+};
+
+// Widest %0Nd of a frame name pattern: the digits of INT_MAX
+const int FRAME_NUMBER_MAX_WIDTH = 10;
+
+/**
+    Split a frame name pattern around its single %d / %0Nd conversion ("%%" is a literal %)
+    @param string prefix, suffix: the name before / after the frame number
+    @param int width: minimum digits, zero padded, at most FRAME_NUMBER_MAX_WIDTH
+    @return false unless name holds exactly one such conversion and no other '%'
+*/
+inline bool parse_frame_pattern(const std::string& name, std::string& prefix, std::string& suffix, int& width) {
+    int conversions = 0;
+    std::string* out = &prefix;
+    prefix.clear();
+    suffix.clear();
+    width = 0;
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (name[i] != '%') {
+            *out += name[i];
+            continue;
+        }
+        if (i + 1 < name.size() && name[i + 1] == '%') {
+            *out += '%';
+            ++i;
+            continue;
+        }
+        size_t j = i + 1;
+        bool zero_pad = j < name.size() && name[j] == '0';
+        int digits = 0;
+        while (j < name.size() && isdigit(static_cast<unsigned char>(name[j])) && digits <= FRAME_NUMBER_MAX_WIDTH)
+            digits = digits * 10 + (name[j++] - '0');
+        if (j >= name.size() || name[j] != 'd' || (digits > 0 && !zero_pad) || digits > FRAME_NUMBER_MAX_WIDTH ||
+            ++conversions > 1)
+            return false;
+        width = digits;
+        out = &suffix;
+        i = j;
+    }
+    return conversions == 1;
+}
+
+/**
+    Output name of frame k: "out_%04d.ppm" style pattern when name has one %d / %0Nd,
+    otherwise "_0000" style numbering before the extension
+*/
+inline std::string frame_file_name(const std::string& name, int frame) {
+    // Sign, FRAME_NUMBER_MAX_WIDTH digits, '_' and '\0' always fit
+    char buffer[FRAME_NUMBER_MAX_WIDTH + 8];
+    std::string prefix, suffix;
+    int width;
+    if (parse_frame_pattern(name, prefix, suffix, width)) {
+        snprintf(buffer, sizeof(buffer), "%0*d", width, frame);
+        return prefix + buffer + suffix;
+    }
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos || dot < name.find_last_of("/\\") + 1)
+        dot = name.size();
+    snprintf(buffer, sizeof(buffer), "_%04d", frame);
+    return name.substr(0, dot) + buffer + name.substr(dot);
+}
+
+#endif
@@ -1,12 +1,34 @@
 #ifndef _CS418_TEXTURE_H
 #define _CS418_TEXTURE_H
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <vector>
 #include "util.h"
+#include "image.h"
+
+enum TextureKind : uint32_t {
+    TEXTURE_SOLID = 0,
+    TEXTURE_CHECKER = 1
+};
+
+// Pointer-free description of a texture (see scene_cache.h)
+struct TextureRecord {
+    uint32_t kind;
+    uint32_t child[2];  // checker: even / odd texture, always described before it
+    uint32_t reserved;
+    double color[3];    // solid
+    double scale;       // checker: uv squares per unit, 0: 3D pattern
+};
 
 class Texture  {
     public:
-        virtual Vec3 value(double u, double v, const Vec3& p) const = 0;
+        // uv_footprint: width of the ray cone in (u, v) units, for filtering (0: unknown)
+        virtual Vec3 value(double u, double v, const Vec3& p, double uv_footprint) const = 0;
+
+        // Append the records of this texture (children first) to table; false if it can't be described
+        virtual bool describe(std::vector<TextureRecord>& table, uint32_t& index) const { return false; }
 };
 
 //Solid Color
@@ -17,10 +39,20 @@ class Solid : public Texture {
 
         Solid(double r, double g, double b): Solid(Vec3(r, g, b)) {}
 
-        Vec3 value(double u, double v, const Vec3& p) const {
+        Vec3 value(double u, double v, const Vec3& p, double uv_footprint) const {
             return color_value;
         }
 
+        bool describe(std::vector<TextureRecord>& table, uint32_t& index) const {
+            TextureRecord record = TextureRecord();
+            record.kind = TEXTURE_SOLID;
+            for (int k = 0; k < 3; ++k)
+                record.color[k] = color_value[k];
+            index = static_cast<uint32_t>(table.size());
+            table.push_back(record);
+            return true;
+        }
+
     private:
         Vec3 color_value;
 };
@@ -29,19 +61,84 @@ class CheckerTexture : public Texture {
     public:
         CheckerTexture() {}
         CheckerTexture(shared_ptr<Texture> t0, shared_ptr<Texture> t1): even(t0), odd(t1) {}
+        // Checker in (u, v) with scale squares per unit, for surfaces where the 3D pattern
+        // degenerates (sin(10y) is 0 on the y = 0 plane)
+        CheckerTexture(shared_ptr<Texture> t0, shared_ptr<Texture> t1, double scale): even(t0), odd(t1), uv_scale(scale) {}
+
+        Vec3 value(double u, double v, const Vec3& p, double uv_footprint) const {
+            if (uv_scale > 0) {
+                long long cell = static_cast<long long>(floor(uv_scale * u)) + static_cast<long long>(floor(uv_scale * v));
+                return (cell & 1) ? odd -> value(u, v, p, uv_footprint) : even -> value(u, v, p, uv_footprint);
+            }
 
-        Vec3 value(double u, double v, const Vec3& p) const {
             // Sign alternate to get checker pattern
             auto sign = sin(10 * p.x()) * sin(10 * p.y()) * sin(10 * p.z());
             if (sign < 0)
-                return odd -> value(u, v, p);
+                return odd -> value(u, v, p, uv_footprint);
             else
-                return even -> value(u, v, p);
+                return even -> value(u, v, p, uv_footprint);
+        }
+
+        bool describe(std::vector<TextureRecord>& table, uint32_t& index) const {
+            TextureRecord record = TextureRecord();
+            record.kind = TEXTURE_CHECKER;
+            record.scale = uv_scale;
+            if (!even -> describe(table, record.child[0]) || !odd -> describe(table, record.child[1]))
+                return false;
+            index = static_cast<uint32_t>(table.size());
+            table.push_back(record);
+            return true;
         }
         
     private:
-        shared_ptr<Texture> odd;
         shared_ptr<Texture> even;
+        shared_ptr<Texture> odd;
+        double uv_scale = 0; // 0: 3D pattern
+};
+
+// Image texture sampled at (u, v) from a tiled, mip-mapped image. The mip level
+// follows the ray footprint: one texel of the level about covers the footprint.
+class ImageTexture : public Texture {
+    public:
+        ImageTexture() {}
+        // lod_bias: levels added to the footprint's (negative: sharper)
+        ImageTexture(shared_ptr<TiledImage> img, double lod_bias = 0) : image(img), bias(lod_bias) {}
+
+        Vec3 value(double u, double v, const Vec3& p, double uv_footprint) const {
+            if (!image)
+                return Vec3(0, 1, 1);
+            double lod = bias;
+            if (uv_footprint > 0)
+                lod += log2(uv_footprint * std::max(image -> width(), image -> height()));
+            // Image rows go top to bottom, v goes bottom to top
+            return image -> sample(u - floor(u), 1.0 - (v - floor(v)), lod);
+        }
+
+    private:
+        shared_ptr<TiledImage> image;
+        double bias;
 };
 
+/**
+    Rebuild a texture from its record
+    @param TextureRecord* table of num_records records
+    @param uint32_t index of the texture in the table
+    @return nullptr for an invalid record
+*/
+inline shared_ptr<Texture> make_texture(const TextureRecord* table, uint32_t num_records, uint32_t index) {
+    if (index >= num_records)
+        return nullptr;
+    const TextureRecord& record = table[index];
+    if (record.kind == TEXTURE_SOLID)
+        return make_shared<Solid>(record.color[0], record.color[1], record.color[2]);
+    if (record.kind != TEXTURE_CHECKER || record.child[0] >= index || record.child[1] >= index)
+        return nullptr;
+
+    auto even = make_texture(table, num_records, record.child[0]);
+    auto odd = make_texture(table, num_records, record.child[1]);
+    if (!even || !odd)
+        return nullptr;
+    return record.scale > 0 ? make_shared<CheckerTexture>(even, odd, record.scale) : make_shared<CheckerTexture>(even, odd);
+}
+
 #endif
@@ -0,0 +1,117 @@
+#ifndef _CS418_TRANSFORM_H
+#define _CS418_TRANSFORM_H
+
+#include "util.h"
+#include "bouding_box.h"
+
+// Affine transform stored as a 3x4 matrix together with its inverse
+// (the inverse is needed every time a ray is moved into object space)
+class Transform {
+    public:
+        Transform() {
+            for (int r = 0; r < 3; ++r)
+                for (int c = 0; c < 4; ++c)
+                    m[r][c] = inv[r][c] = (r == c) ? 1.0 : 0.0;
+        }
+
+        static Transform translate(const Vec3& offset) {
+            Transform t;
+            for (int r = 0; r < 3; ++r) {
+                t.m[r][3] = offset[r];
+                t.inv[r][3] = -offset[r];
+            }
+            return t;
+        }
+
+        static Transform scale(const Vec3& s) {
+            Transform t;
+            for (int r = 0; r < 3; ++r) {
+                t.m[r][r] = s[r];
+                t.inv[r][r] = 1.0 / s[r];
+            }
+            return t;
+        }
+
+        static Transform scale(double s) { return scale(Vec3(s, s, s)); }
+
+        // Rotation around the y axis (degrees)
+        static Transform rotate_y(double degrees) {
+            Transform t;
+            double c = cos(deg_to_rad(degrees)), s = sin(deg_to_rad(degrees));
+            t.m[0][0] = c;  t.m[0][2] = s;
+            t.m[2][0] = -s; t.m[2][2] = c;
+            // Inverse of a rotation is its transpose
+            t.inv[0][0] = c; t.inv[0][2] = -s;
+            t.inv[2][0] = s; t.inv[2][2] = c;
+            return t;
+        }
+
+        // Composition: (a * b) applies b first, then a
+        Transform operator*(const Transform& b) const {
+            Transform t;
+            multiply(m, b.m, t.m);
+            multiply(b.inv, inv, t.inv);
+            return t;
+        }
+
+        Transform inverse() const {
+            Transform t;
+            for (int r = 0; r < 3; ++r)
+                for (int c = 0; c < 4; ++c) {
+                    t.m[r][c] = inv[r][c];
+                    t.inv[r][c] = m[r][c];
+                }
+            return t;
+        }
+
+        Vec3 point(const Vec3& p) const { return apply(m, p, 1.0); }
+        Vec3 vector(const Vec3& v) const { return apply(m, v, 0.0); }
+        Vec3 inverse_point(const Vec3& p) const { return apply(inv, p, 1.0); }
+        Vec3 inverse_vector(const Vec3& v) const { return apply(inv, v, 0.0); }
+
+        // Normals transform by the inverse transpose (result is not normalized)
+        Vec3 normal(const Vec3& n) const {
+            return Vec3(inv[0][0]*n[0] + inv[1][0]*n[1] + inv[2][0]*n[2],
+                        inv[0][1]*n[0] + inv[1][1]*n[1] + inv[2][1]*n[2],
+                        inv[0][2]*n[0] + inv[1][2]*n[1] + inv[2][2]*n[2]);
+        }
+
+        // Bounding box of the 8 transformed corners
+        BoundingBox box(const BoundingBox& b) const {
+            Vec3 small( INF_DOUBLE,  INF_DOUBLE,  INF_DOUBLE);
+            Vec3 big  (-INF_DOUBLE, -INF_DOUBLE, -INF_DOUBLE);
+            for (int i = 0; i < 8; ++i) {
+                Vec3 corner((i & 1) ? b.max().x() : b.min().x(),
+                            (i & 2) ? b.max().y() : b.min().y(),
+                            (i & 4) ? b.max().z() : b.min().z());
+                Vec3 p = point(corner);
+                for (int a = 0; a < 3; ++a) {
+                    small[a] = fmin(small[a], p[a]);
+                    big[a] = fmax(big[a], p[a]);
+                }
+            }
+            return BoundingBox(small, big);
+        }
+
+    private:
+        static Vec3 apply(const double mat[3][4], const Vec3& v, double w) {
+            return Vec3(mat[0][0]*v[0] + mat[0][1]*v[1] + mat[0][2]*v[2] + mat[0][3]*w,
+                        mat[1][0]*v[0] + mat[1][1]*v[1] + mat[1][2]*v[2] + mat[1][3]*w,
+                        mat[2][0]*v[0] + mat[2][1]*v[1] + mat[2][2]*v[2] + mat[2][3]*w);
+        }
+
+        // out = a * b, treating both as 4x4 matrices with an implicit (0,0,0,1) row
+        static void multiply(const double a[3][4], const double b[3][4], double out[3][4]) {
+            for (int r = 0; r < 3; ++r) {
+                for (int c = 0; c < 4; ++c) {
+                    out[r][c] = a[r][0]*b[0][c] + a[r][1]*b[1][c] + a[r][2]*b[2][c];
+                }
+                out[r][3] += a[r][3];
+            }
+        }
+
+        double m[3][4];
+        double inv[3][4];
+};
+
+#endif
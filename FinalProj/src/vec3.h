@@ -4,6 +4,8 @@
 #include <cmath>
 #include <iostream>
 
+#include "scalar.h"
+
 using std::sqrt;
 
 class Vec3 {
@@ -27,7 +29,7 @@ class Vec3 {
             return Vec3(e[0] - other.e[0], e[1] - other.e[1], e[2] - other.e[2]);
         }
 
-        Vec3 operator*(const Vec3 &other) {
+        Vec3 operator*(const Vec3 &other) const {
             return Vec3(e[0] * other.e[0], e[1] * other.e[1], e[2] * other.e[2]);
         }
         
@@ -127,16 +129,21 @@ inline Vec3 unit_vector(Vec3 v) {
     return v / v.length();
 }
 
+// Rec. 709 luminance of a linear color
+inline double luminance(const Vec3& c) {
+    return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
 // Util Function (can't fit in util.h)
 
-Vec3 generate_random_unit_vec() {
+inline Vec3 generate_random_unit_vec() {
     auto a = generate_random_double(0, 2 * PI);
     auto z = generate_random_double(-1, 1);
     auto r = sqrt(1 - z*z);
     return Vec3(r*cos(a), r*sin(a), z);
 }
 
-Vec3 generate_random_vec_sphere() {
+inline Vec3 generate_random_vec_sphere() {
     Vec3 p = Vec3::random(-1,1);
     while (p.square_len() >= 1) {
         p = Vec3::random(-1,1); 
@@ -144,7 +151,7 @@ Vec3 generate_random_vec_sphere() {
     return p;
 }
 
-Vec3 generate_random_vec_circle() {
+inline Vec3 generate_random_vec_circle() {
     Vec3 p = Vec3(generate_random_double(-1,1), generate_random_double(-1,1), 0);
     while (p.square_len() >= 1) {
         p = Vec3(generate_random_double(-1,1), generate_random_double(-1,1), 0);
@@ -152,11 +159,11 @@ Vec3 generate_random_vec_circle() {
     return p;
 }
 
-Vec3 reflect(const Vec3& v, const Vec3& n) {
+inline Vec3 reflect(const Vec3& v, const Vec3& n) {
     return v - 2*dot(v,n)*n;
 }
 
-Vec3 refract(const Vec3& uv, const Vec3& n, double etai_over_etat) {
+inline Vec3 refract(const Vec3& uv, const Vec3& n, double etai_over_etat) {
     auto cos_theta = fmin(dot(-uv, n), 1.0);
     Vec3 r_out_parallel =  etai_over_etat * (uv + cos_theta*n);
     Vec3 r_out_perp = -sqrt(1.0 - r_out_parallel.square_len()) * n;
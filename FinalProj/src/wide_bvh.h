@@ -0,0 +1,335 @@
+#ifndef _CS418_WIDE_BVH_H
+#define _CS418_WIDE_BVH_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CS418_WIDE_BVH_SSE 1
+#endif
+
+#include "util.h"
+#include "object.h"
+
+// Wide BVH: the binary tree is collapsed into WIDTH-ary nodes (4 or 8) stored in one
+// flat array. Child boxes are quantized to 8 bits relative to the node bounds, so a
+// 4-wide node fits in one cache line (two for 8-wide), and all children of a node
+// are tested with one SIMD slab test (no divisions: the ray keeps 1/direction).
+template <int WIDTH>
+class WideBVH : public Object {
+    public:
+        WideBVH() {}
+
+        WideBVH(const std::vector<shared_ptr<Object>>& objects) : primitives(objects) {
+            if (primitives.empty())
+                return;
+
+            std::vector<BuildNode> tree;
+            std::vector<int> indices(primitives.size());
+            std::vector<BoundingBox> boxes(primitives.size());
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                indices[i] = static_cast<int>(i);
+                if (!primitives[i]->get_bbox(boxes[i]))
+                    std::cerr << "No bounding box in WideBVH constructor.\n";
+            }
+            tree.reserve(2 * primitives.size());
+            int root = build_binary(tree, boxes, indices, 0, static_cast<int>(indices.size()));
+            root_box = tree[root].box;
+
+            std::vector<Node> flat;
+            if (tree[root].prim >= 0) {
+                // Single primitive: one node with one child
+                flat.push_back(Node());
+                quantize(flat[0], tree, std::vector<int>(1, root));
+                flat[0].child[0] = ~tree[root].prim;
+            } else {
+                collapse(tree, root, flat);
+            }
+            // Each popped node adds at most WIDTH - 1 entries, so intersect never needs more than
+            // (depth - 1) * (WIDTH - 1) + 1; median splits keep depth within 32 levels
+            assert((subtree_depth(flat, 0) - 1) * (WIDTH - 1) + 1 <= STACK_SIZE && "WideBVH deeper than its traversal stack");
+
+            // Copy nodes to cache-line aligned storage
+            storage.resize(flat.size() * sizeof(Node) + CACHE_LINE);
+            size_t offset = (CACHE_LINE - reinterpret_cast<uintptr_t>(storage.data()) % CACHE_LINE) % CACHE_LINE;
+            nodes = reinterpret_cast<Node*>(storage.data() + offset);
+            memcpy(nodes, flat.data(), flat.size() * sizeof(Node));
+            node_count = flat.size();
+        }
+
+        // Not copyable: nodes points into storage
+        WideBVH(const WideBVH&) = delete;
+        WideBVH& operator=(const WideBVH&) = delete;
+
+        size_t num_nodes() const { return node_count; }
+        // Node storage, including its cache-line alignment padding
+        size_t memory_bytes() const { return storage.size(); }
+
+        bool intersect(const Ray& r, double t_min, double t_max, Intersection& int_pt) const {
+            if (node_count == 0)
+                return false;
+
+            RayData ray;
+            for (int a = 0; a < 3; ++a) {
+                double d = r.direction()[a];
+                if (fabs(d) < 1e-12)
+                    d = d < 0 ? -1e-12 : 1e-12;
+                ray.origin[a] = static_cast<float>(r.origin()[a]);
+                ray.inv_dir[a] = static_cast<float>(1.0 / d);
+            }
+
+            // Entries carry the entry distance so far-away subtrees can be skipped
+            struct StackEntry { int node; float t; };
+            StackEntry stack[STACK_SIZE];
+            int stack_size = 0;
+            stack[stack_size++] = {0, static_cast<float>(t_min)};
+
+            bool hit = false;
+            double closest = t_max;
+            while (stack_size > 0) {
+                StackEntry entry = stack[--stack_size];
+                if (entry.t > closest)
+                    continue;
+
+                const Node& node = nodes[entry.node];
+                float t_near[WIDTH];
+                int hit_mask = slab_test(node, ray, static_cast<float>(t_min), static_cast<float>(closest), t_near);
+
+                // Children sorted far to near: order[count - 1] is the nearest
+                int order[WIDTH], count = 0;
+                for (int i = 0; i < node.num_children; ++i) {
+                    if (!(hit_mask & (1 << i)))
+                        continue;
+                    int k = count++;
+                    while (k > 0 && t_near[order[k - 1]] < t_near[i]) {
+                        order[k] = order[k - 1];
+                        --k;
+                    }
+                    order[k] = i;
+                }
+                // Primitives nearest first, so closest shrinks as early as possible
+                for (int k = count - 1; k >= 0; --k) {
+                    int child = node.child[order[k]];
+                    if (child < 0 && primitives[~child]->intersect(r, t_min, closest, int_pt)) {
+                        hit = true;
+                        closest = int_pt.t;
+                    }
+                }
+                // Inner nodes pushed farthest first, so the nearest is popped next
+                for (int k = 0; k < count; ++k) {
+                    int child = node.child[order[k]];
+                    if (child >= 0 && t_near[order[k]] <= closest)
+                        stack[stack_size++] = {child, t_near[order[k]]};
+                }
+            }
+            return hit;
+        }
+
+        bool get_bbox(BoundingBox& output_box) const {
+            output_box = root_box;
+            return node_count > 0;
+        }
+
+    private:
+        static const int CACHE_LINE = 64;
+        static const int STACK_SIZE = 64 * WIDTH;
+
+        // Child c of the node spans origin + q * 2^exponent on each axis
+        struct alignas(64) Node {
+            float origin[3];
+            int8_t exponent[3];
+            uint8_t num_children;
+            uint8_t qlo[3][WIDTH];
+            uint8_t qhi[3][WIDTH];
+            int32_t child[WIDTH]; // >= 0: node index, < 0: ~primitive index
+        };
+
+        struct RayData {
+            float origin[3];
+            float inv_dir[3];
+        };
+
+        struct BuildNode {
+            BoundingBox box;
+            int left, right;
+            int prim; // >= 0 for leaves
+        };
+
+        // Median split on the longest axis of the centroid bounds
+        static int build_binary(std::vector<BuildNode>& tree, const std::vector<BoundingBox>& boxes,
+                                std::vector<int>& indices, int start, int end) {
+            BuildNode node;
+            node.left = node.right = node.prim = -1;
+            if (end - start == 1) {
+                node.prim = indices[start];
+                node.box = boxes[node.prim];
+                tree.push_back(node);
+                return static_cast<int>(tree.size()) - 1;
+            }
+
+            Vec3 lo(INF_DOUBLE, INF_DOUBLE, INF_DOUBLE), hi(-INF_DOUBLE, -INF_DOUBLE, -INF_DOUBLE);
+            for (int i = start; i < end; ++i) {
+                Vec3 c = 0.5 * (boxes[indices[i]].min() + boxes[indices[i]].max());
+                for (int a = 0; a < 3; ++a) {
+                    lo[a] = fmin(lo[a], c[a]);
+                    hi[a] = fmax(hi[a], c[a]);
+                }
+            }
+            int axis = BoundingBox(lo, hi).longest_axis();
+
+            int mid = start + (end - start) / 2;
+            std::nth_element(indices.begin() + start, indices.begin() + mid, indices.begin() + end,
+                [&](int a, int b) { return boxes[a].min()[axis] + boxes[a].max()[axis] < boxes[b].min()[axis] + boxes[b].max()[axis]; });
+
+            node.left = build_binary(tree, boxes, indices, start, mid);
+            node.right = build_binary(tree, boxes, indices, mid, end);
+            node.box = surrounding_box(tree[node.left].box, tree[node.right].box);
+            tree.push_back(node);
+            return static_cast<int>(tree.size()) - 1;
+        }
+
+        // Pull grandchildren up (largest surface area first) until the node is WIDTH wide
+        static int collapse(const std::vector<BuildNode>& tree, int root, std::vector<Node>& flat) {
+            std::vector<int> children;
+            children.push_back(tree[root].left);
+            children.push_back(tree[root].right);
+            while (static_cast<int>(children.size()) < WIDTH) {
+                int best = -1;
+                for (size_t i = 0; i < children.size(); ++i) {
+                    if (tree[children[i]].prim < 0 && (best < 0 || tree[children[i]].box.area() > tree[children[best]].box.area()))
+                        best = static_cast<int>(i);
+                }
+                if (best < 0)
+                    break;
+                int expanded = children[best];
+                children[best] = tree[expanded].left;
+                children.push_back(tree[expanded].right);
+            }
+
+            int index = static_cast<int>(flat.size());
+            flat.push_back(Node());
+            quantize(flat[index], tree, children);
+            for (size_t i = 0; i < children.size(); ++i) {
+                const BuildNode& c = tree[children[i]];
+                int32_t child = c.prim >= 0 ? ~c.prim : collapse(tree, children[i], flat);
+                flat[index].child[i] = child;
+            }
+            return index;
+        }
+
+        // Levels of the subtree at index (children always follow their parent in flat)
+        static int subtree_depth(const std::vector<Node>& flat, int index) {
+            int depth = 0;
+            for (int i = 0; i < flat[index].num_children; ++i) {
+                if (flat[index].child[i] >= 0)
+                    depth = std::max(depth, subtree_depth(flat, flat[index].child[i]));
+            }
+            return depth + 1;
+        }
+
+        // Conservative 8-bit child bounds relative to the union of the children
+        static void quantize(Node& node, const std::vector<BuildNode>& tree, const std::vector<int>& children) {
+            memset(&node, 0, sizeof(Node));
+            node.num_children = static_cast<uint8_t>(children.size());
+
+            BoundingBox parent = tree[children[0]].box;
+            for (size_t i = 1; i < children.size(); ++i)
+                parent = surrounding_box(parent, tree[children[i]].box);
+
+            for (int a = 0; a < 3; ++a) {
+                float origin = static_cast<float>(parent.min()[a]);
+                if (origin > parent.min()[a])
+                    origin = nextafterf(origin, -INFINITY);
+                double extent = parent.max()[a] - origin;
+
+                // Smallest power of two step with the extent covered in 254 steps (1 spare for rounding)
+                int exponent;
+                frexp(fmax(extent / 254.0, 1e-30), &exponent);
+                exponent = std::max(exponent, -100);
+                float scale = ldexpf(1.0f, exponent);
+
+                node.origin[a] = origin;
+                node.exponent[a] = static_cast<int8_t>(exponent);
+                for (size_t i = 0; i < children.size(); ++i) {
+                    const BoundingBox& b = tree[children[i]].box;
+                    int lo = static_cast<int>(floor((b.min()[a] - origin) / scale));
+                    int hi = static_cast<int>(ceil((b.max()[a] - origin) / scale));
+                    lo = std::max(lo, 0);
+                    hi = std::min(hi, 255);
+                    // Make sure float dequantization still contains the box
+                    while (lo > 0 && origin + lo * scale > b.min()[a]) --lo;
+                    while (hi < 255 && origin + hi * scale < b.max()[a]) ++hi;
+                    node.qlo[a][i] = static_cast<uint8_t>(lo);
+                    node.qhi[a][i] = static_cast<uint8_t>(hi);
+                }
+            }
+        }
+
+        // Bit i set when child i is hit in [t_min, t_max]; t_near receives entry distances
+        static int slab_test(const Node& node, const RayData& ray, float t_min, float t_max, float* t_near) {
+            // t = A + q * B per axis, with A, B shared by all children
+            float A[3], B[3];
+            for (int a = 0; a < 3; ++a) {
+                A[a] = (node.origin[a] - ray.origin[a]) * ray.inv_dir[a];
+                B[a] = ldexpf(1.0f, node.exponent[a]) * ray.inv_dir[a];
+            }
+
+            // Exit distances are padded to absorb float rounding of the dequantized planes
+            const float pad = 1.0f + 1e-5f;
+            int mask = 0;
+#ifdef CS418_WIDE_BVH_SSE
+            for (int base = 0; base < WIDTH; base += 4) {
+                __m128 lo_t = _mm_set1_ps(t_min), hi_t = _mm_set1_ps(t_max), vpad = _mm_set1_ps(pad);
+                for (int a = 0; a < 3; ++a) {
+                    __m128 qlo = load_quantized(&node.qlo[a][base]);
+                    __m128 qhi = load_quantized(&node.qhi[a][base]);
+                    __m128 va = _mm_set1_ps(A[a]), vb = _mm_set1_ps(B[a]);
+                    __m128 t0 = _mm_add_ps(va, _mm_mul_ps(qlo, vb));
+                    __m128 t1 = _mm_add_ps(va, _mm_mul_ps(qhi, vb));
+                    lo_t = _mm_max_ps(lo_t, _mm_min_ps(t0, t1));
+                    hi_t = _mm_min_ps(hi_t, _mm_mul_ps(_mm_max_ps(t0, t1), vpad));
+                }
+                _mm_storeu_ps(t_near + base, lo_t);
+                mask |= _mm_movemask_ps(_mm_cmple_ps(lo_t, hi_t)) << base;
+            }
+#else
+            for (int i = 0; i < WIDTH; ++i) {
+                float lo_t = t_min, hi_t = t_max;
+                for (int a = 0; a < 3; ++a) {
+                    float t0 = A[a] + node.qlo[a][i] * B[a];
+                    float t1 = A[a] + node.qhi[a][i] * B[a];
+                    lo_t = std::max(lo_t, std::min(t0, t1));
+                    hi_t = std::min(hi_t, std::max(t0, t1) * pad);
+                }
+                t_near[i] = lo_t;
+                if (lo_t <= hi_t)
+                    mask |= 1 << i;
+            }
+#endif
+            return mask & ((1 << node.num_children) - 1);
+        }
+
+#ifdef CS418_WIDE_BVH_SSE
+        // 4 quantized bytes -> 4 floats (SSE2 only)
+        static __m128 load_quantized(const uint8_t* q) {
+            int32_t packed;
+            memcpy(&packed, q, sizeof(packed));
+            __m128i zero = _mm_setzero_si128();
+            __m128i bytes = _mm_cvtsi32_si128(packed);
+            __m128i words = _mm_unpacklo_epi8(bytes, zero);
+            return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+        }
+#endif
+
+        std::vector<shared_ptr<Object>> primitives;
+        std::vector<unsigned char> storage;
+        Node* nodes = nullptr;
+        size_t node_count = 0;
+        BoundingBox root_box;
+};
+
+#endif